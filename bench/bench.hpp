@@ -0,0 +1,27 @@
+#pragma once
+
+// helpers shared by the Linux benchmarks
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+// number of operator new calls since the program started
+uint64_t allocationCount();
+
+template <typename T>
+inline void doNotOptimize(T const& value) {
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// benches that verify their results before timing them stop after the checks with --check, which is how ctest runs them
+inline bool checkOnly(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--check") == 0) return true;
+	}
+	return false;
+}
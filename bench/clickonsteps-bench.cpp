@@ -0,0 +1,161 @@
+// Click on Steps frames: the full step plan popped by processCommands vs tick buckets, next to handing every input out as it comes
+
+#include "bench.hpp"
+
+#include "core/scheduler.hpp"
+#include "core/inputlanes.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+constexpr TimestampType TICKS_PER_SECOND = 10'000'000;
+constexpr int FRAMES = 50'000;
+constexpr int ROUNDS = 5;
+
+struct StubLayer {
+	int tick = 0;
+	std::vector<std::pair<int, TimestampType>>* log = nullptr; // every dispatched input and the tick it went out on
+
+	__attribute__((noinline)) void handleButton(const InputEvent& input) {
+		doNotOptimize(input);
+		if (log) log->emplace_back(tick, input.time);
+	}
+};
+
+// PlayLayer::get() goes through GameManager, the old loop did that once per pop
+StubLayer* currentLayer = nullptr;
+
+__attribute__((noinline)) StubLayer* getLayer() {
+	return currentLayer;
+}
+
+enum class Path {
+	Vanilla, // every input goes to handleButton as it comes, nothing is placed
+	Plan,  // buildStepQueue, then processCommands pops to the end step and update looks at the next one
+	Ticks  // buildTickBuckets, then processCommands dispatches the tick
+};
+
+// one step of the game: processCommands, then PlayerObject::update
+template <Path P>
+void runStep(StepScheduler& s) {
+	if constexpr (P == Path::Plan) {
+		if (hasNextStep(s)) {
+			Step step;
+			do step = popStepQueue(s, [](const InputEvent& input) { getLayer()->handleButton(input); });
+			while (hasNextStep(s) && !step.endStep);
+		}
+
+		const bool stepPlanned = hasNextStep(s);
+		doNotOptimize(stepPlanned && !s.stepQueue.front().endStep);
+	}
+	else if constexpr (P == Path::Ticks) {
+		dispatchTick(s, [](const InputEvent* inputs, size_t count) {
+			StubLayer* layer = getLayer();
+			for (size_t i = 0; i < count; i++) layer->handleButton(inputs[i]);
+		});
+	}
+}
+
+struct Workload {
+	const char* name;
+	int fps;
+	int inputsPerFrame;
+};
+
+// best time over ROUNDS in ns per frame, from the drain to the last step
+template <Path P>
+double run(const Workload& w, std::vector<std::pair<int, TimestampType>>* log) {
+	int64_t best = INT64_MAX;
+
+	for (int round = 0; round < ROUNDS; round++) {
+		auto s = std::make_unique<StepScheduler>();
+		VirtualClock clock(TICKS_PER_SECOND, TICKS_PER_SECOND);
+		s->clock = &clock;
+		auto lanes = std::make_unique<InputLanes>();
+		StubLayer layer;
+		layer.log = round == 0 ? log : nullptr;
+		currentLayer = &layer;
+
+		std::mt19937_64 rng(91);
+		const TimestampType frameTicks = TICKS_PER_SECOND / w.fps;
+		const int stepCount = std::max(1, 240 / w.fps);
+		std::vector<TimestampType> times(w.inputsPerFrame);
+		int64_t total = 0;
+
+		for (int frame = 0; frame < FRAMES; frame++) {
+			// some inputs come in after the cutoff and are carried into the next frame
+			std::uniform_int_distribution<TimestampType> offset(1, frameTicks + frameTicks / 8);
+			for (auto& t : times) t = clock.now() + offset(rng);
+			std::sort(times.begin(), times.end());
+			for (size_t i = 0; i < times.size(); i++) {
+				lanes->push(RawInputLane, InputEvent{ times[i], InputButton::Jump, (i & 1) == 0, true });
+			}
+			clock.advance(frameTicks);
+
+			const int64_t start = nowNs();
+			markFrameTime(*s);
+			drainInputs(*s, *lanes, false, frameInputLimit(*s));
+			if constexpr (P == Path::Plan) buildStepQueue(*s, stepCount);
+			else if constexpr (P == Path::Ticks) buildTickBuckets(*s, stepCount);
+			else {
+				for (size_t i = s->inputHead; i < s->inputCount; i++) layer.handleButton(s->inputs[i]);
+				s->inputHead = s->inputCount;
+			}
+
+			for (int i = 0; i < stepCount; i++) {
+				layer.tick = frame * stepCount + i;
+				runStep<P>(*s);
+			}
+			total += nowNs() - start;
+		}
+
+		best = std::min(best, total);
+	}
+	return static_cast<double>(best) / FRAMES;
+}
+
+int main(int argc, char** argv) {
+	const Workload workloads[] = {
+		{ "60 fps, no inputs", 60, 0 },
+		{ "60 fps, 2 inputs", 60, 2 },
+		{ "60 fps, 8 inputs", 60, 8 },
+		{ "240 fps, 1 input", 240, 1 },
+		{ "30 fps, 16 inputs", 30, 16 },
+	};
+
+	for (const Workload& w : workloads) {
+		std::vector<std::pair<int, TimestampType>> plan, ticks;
+		run<Path::Plan>(w, &plan);
+		run<Path::Ticks>(w, &ticks);
+		if (plan != ticks) {
+			std::fprintf(stderr, "%s: tick buckets dispatched different inputs or ticks than the step plan\n", w.name);
+			return 1;
+		}
+	}
+	// a switch to the step queue mid-frame must not plan from the fractions buildTickBuckets never wrote
+	{
+		auto s = std::make_unique<StepScheduler>();
+		auto lanes = std::make_unique<InputLanes>();
+		s->currentFrameTime = TICKS_PER_SECOND;
+		buildTickBuckets(*s, 4);
+		lanes->push(RawInputLane, InputEvent{ s->currentFrameTime + 1000, InputButton::Jump, true, true });
+		s->currentFrameTime += TICKS_PER_SECOND / 60;
+		drainInputs(*s, *lanes, false);
+		buildTickBuckets(*s, 4);
+		if (hasNextStep(*s)) {
+			std::fprintf(stderr, "the step queue planned from a tick bucket frame\n");
+			return 1;
+		}
+	}
+	std::printf("every workload dispatches the same inputs on the same ticks on both paths\n\n");
+	if (checkOnly(argc, argv)) return 0;
+
+	std::printf("%-22s %12s %12s %12s   (ns per frame, best of %d)\n", "workload", "vanilla", "step plan", "tick buckets", ROUNDS);
+	for (const Workload& w : workloads) {
+		std::printf("%-22s %12.1f %12.1f %12.1f\n", w.name, run<Path::Vanilla>(w, nullptr), run<Path::Plan>(w, nullptr), run<Path::Ticks>(w, nullptr));
+	}
+	return 0;
+}
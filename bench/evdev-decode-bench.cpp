@@ -0,0 +1,287 @@
+// per-event decode cost in the Linux input helper: per-event classification vs the per-device cache
+
+#include "bench.hpp"
+
+#include "linux/evdev-decode.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+constexpr int SECONDS = 5;
+constexpr int MOUSE_HZ = 8000;
+constexpr int CONTROLLER_HZ = 1000;
+constexpr int ROUNDS = 20;
+
+// the wide controller's stick, about 31 bits of range while the old float path still fits in an int
+constexpr int32_t WIDE_AXIS_MIN = -(1 << 30);
+constexpr int32_t WIDE_AXIS_MAX = (1 << 30) - 1;
+
+/*
+Stand-in for libevdev: the capability queries are out of line library calls doing bit tests,
+so they are kept out of line here too.
+*/
+struct FakeEvdev {
+	std::bitset<EV_CNT> types;
+	std::bitset<KEY_CNT> keys;
+	std::bitset<ABS_CNT> axes;
+	std::bitset<INPUT_PROP_CNT> props;
+	int abs_min[ABS_CNT]{};
+	int abs_max[ABS_CNT]{};
+};
+
+__attribute__((noinline)) bool fake_has_event_type(const FakeEvdev* dev, unsigned int type) {
+	return type < EV_CNT && dev->types[type];
+}
+
+__attribute__((noinline)) bool fake_has_event_code(const FakeEvdev* dev, unsigned int type, unsigned int code) {
+	if (!fake_has_event_type(dev, type)) return false;
+	if (type == EV_KEY) return code < KEY_CNT && dev->keys[code];
+	if (type == EV_ABS) return code < ABS_CNT && dev->axes[code];
+	return true;
+}
+
+__attribute__((noinline)) bool fake_has_property(const FakeEvdev* dev, unsigned int prop) {
+	return prop < INPUT_PROP_CNT && dev->props[prop];
+}
+
+__attribute__((noinline)) int fake_get_abs_minimum(const FakeEvdev* dev, unsigned int code) {
+	return fake_has_event_code(dev, EV_ABS, code) ? dev->abs_min[code] : 0;
+}
+
+__attribute__((noinline)) int fake_get_abs_maximum(const FakeEvdev* dev, unsigned int code) {
+	return fake_has_event_code(dev, EV_ABS, code) ? dev->abs_max[code] : 0;
+}
+
+int32_t legacy_normalize_axis(const FakeEvdev* dev, int code, int val, int min, int max) {
+	int abs_min = fake_get_abs_minimum(dev, code);
+	int abs_max = fake_get_abs_maximum(dev, code);
+	float normalized = static_cast<float>(val - abs_min) / static_cast<float>(abs_max - abs_min);
+	int32_t scaled = static_cast<int32_t>(normalized * (max - min)) + min;
+	return scaled;
+}
+
+// what the helper used to do for every event
+bool legacy_decode(const FakeEvdev* dev, const input_event& ev, LinuxInputEvent& out) {
+	int64_t time = convert_time(ev.time);
+	uint16_t code = ev.code;
+	int value = ev.value;
+	DeviceType device_type;
+
+	if (fake_has_event_type(dev, EV_REL)) {
+		if (ev.type != EV_KEY || ev.value == 2) return false;
+		device_type = MOUSE;
+	}
+	else if (fake_has_event_code(dev, EV_KEY, KEY_1)) {
+		if (ev.type != EV_KEY || ev.value == 2) return false;
+		device_type = KEYBOARD;
+		code = convert_scan_code(ev.code);
+	}
+	else if (fake_has_property(dev, INPUT_PROP_DIRECT)) {
+		if (ev.type != EV_KEY || ev.value == 2) return false;
+		device_type = TOUCHSCREEN;
+	}
+	else if (fake_has_property(dev, INPUT_PROP_BUTTONPAD)) {
+		if (ev.type != EV_KEY || ev.value == 2) return false;
+		device_type = TOUCHPAD;
+	}
+	else if (fake_has_event_code(dev, EV_KEY, BTN_GAMEPAD)) {
+		device_type = CONTROLLER;
+		if (ev.type == EV_ABS) {
+			if (ev.code == ABS_Z || ev.code == ABS_RZ) value = legacy_normalize_axis(dev, code, value, 0, 255);
+			else value = legacy_normalize_axis(dev, code, value, -32768, 32767);
+		}
+		else if (ev.type != EV_KEY || ev.value == 2) return false;
+	}
+	else {
+		if (ev.type != EV_KEY || ev.value == 2) return false;
+		device_type = UNKNOWN;
+	}
+
+	out = LinuxInputEvent{ time, ev.type, code, value, device_type };
+	return true;
+}
+
+struct Device {
+	FakeEvdev fake;
+	EvdevDevice cached;
+};
+
+// same as add_input_device, against the fake
+void setup_cache(Device& device) {
+	const FakeEvdev* dev = &device.fake;
+	device.cached.type = classify_device(
+		fake_has_event_type(dev, EV_REL),
+		fake_has_event_code(dev, EV_KEY, KEY_1),
+		fake_has_property(dev, INPUT_PROP_DIRECT),
+		fake_has_property(dev, INPUT_PROP_BUTTONPAD),
+		fake_has_event_code(dev, EV_KEY, BTN_GAMEPAD)
+	);
+	if (device.cached.type != CONTROLLER) return;
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		if (fake_has_event_code(dev, EV_ABS, code)) {
+			set_axis_range(device.cached, code, fake_get_abs_minimum(dev, code), fake_get_abs_maximum(dev, code));
+		}
+	}
+}
+
+struct StreamEvent {
+	uint32_t device;
+	input_event ev;
+};
+
+input_event make_event(int64_t us, uint16_t type, uint16_t code, int32_t value) {
+	input_event ev{};
+	ev.time.tv_sec = us / 1'000'000;
+	ev.time.tv_usec = us % 1'000'000;
+	ev.type = type;
+	ev.code = code;
+	ev.value = value;
+	return ev;
+}
+
+/*
+An 8 kHz mouse (motion on every report, a click every 100ms), a keyboard with autorepeat
+and two 1 kHz controllers moving sticks and triggers.
+*/
+std::vector<StreamEvent> build_stream() {
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<int> motion(-8, 8);
+	std::uniform_int_distribution<int32_t> wideAxis(WIDE_AXIS_MIN, WIDE_AXIS_MAX);
+	std::vector<StreamEvent> stream;
+
+	const int64_t end = SECONDS * 1'000'000LL;
+	for (int64_t tick = 0; tick * 1'000'000 / MOUSE_HZ < end; tick++) {
+		const int64_t us = tick * 1'000'000 / MOUSE_HZ;
+
+		stream.push_back({ 0, make_event(us, EV_REL, REL_X, motion(rng)) });
+		stream.push_back({ 0, make_event(us, EV_REL, REL_Y, motion(rng)) });
+		if (tick % (MOUSE_HZ / 10) == 0) stream.push_back({ 0, make_event(us, EV_KEY, BTN_LEFT, (tick / (MOUSE_HZ / 10)) & 1) });
+		stream.push_back({ 0, make_event(us, EV_SYN, SYN_REPORT, 0) });
+
+		if (tick % (MOUSE_HZ / CONTROLLER_HZ) == 0) {
+			stream.push_back({ 2, make_event(us, EV_ABS, ABS_X, static_cast<int32_t>(rng() % 65536) - 32768) });
+			stream.push_back({ 2, make_event(us, EV_ABS, ABS_Y, static_cast<int32_t>(rng() % 65536) - 32768) });
+			stream.push_back({ 2, make_event(us, EV_ABS, ABS_RZ, static_cast<int32_t>(rng() % 1024)) });
+			stream.push_back({ 2, make_event(us, EV_SYN, SYN_REPORT, 0) });
+
+			stream.push_back({ 3, make_event(us, EV_ABS, ABS_X, wideAxis(rng)) });
+			stream.push_back({ 3, make_event(us, EV_ABS, ABS_Z, static_cast<int32_t>(rng() % 4096)) });
+			stream.push_back({ 3, make_event(us, EV_SYN, SYN_REPORT, 0) });
+		}
+
+		if (tick % (MOUSE_HZ / 30) == 0) {
+			stream.push_back({ 1, make_event(us, EV_MSC, MSC_SCAN, 0x70004) });
+			stream.push_back({ 1, make_event(us, EV_KEY, KEY_SPACE, static_cast<int32_t>(rng() % 3)) });
+			stream.push_back({ 1, make_event(us, EV_SYN, SYN_REPORT, 0) });
+		}
+	}
+	return stream;
+}
+
+std::vector<Device> build_devices() {
+	std::vector<Device> devices(4);
+
+	FakeEvdev& mouse = devices[0].fake;
+	mouse.types.set(EV_SYN).set(EV_KEY).set(EV_REL);
+	mouse.keys.set(BTN_LEFT).set(BTN_RIGHT);
+
+	FakeEvdev& keyboard = devices[1].fake;
+	keyboard.types.set(EV_SYN).set(EV_KEY).set(EV_MSC);
+	for (int code = KEY_ESC; code <= KEY_MICMUTE; code++) keyboard.keys.set(code);
+
+	FakeEvdev& pad = devices[2].fake;
+	pad.types.set(EV_SYN).set(EV_KEY).set(EV_ABS);
+	pad.keys.set(BTN_GAMEPAD).set(BTN_EAST);
+	for (int code : { ABS_X, ABS_Y, ABS_RX, ABS_RY }) {
+		pad.axes.set(code);
+		pad.abs_min[code] = -32768;
+		pad.abs_max[code] = 32767;
+	}
+	for (int code : { ABS_Z, ABS_RZ }) {
+		pad.axes.set(code);
+		pad.abs_max[code] = 1023;
+	}
+
+	// a non power of two trigger and a stick far wider than 16 bits, where multiplier rounding shows the most
+	FakeEvdev& wide = devices[3].fake;
+	wide.types.set(EV_SYN).set(EV_KEY).set(EV_ABS);
+	wide.keys.set(BTN_GAMEPAD);
+	wide.axes.set(ABS_X).set(ABS_Z);
+	wide.abs_min[ABS_X] = WIDE_AXIS_MIN;
+	wide.abs_max[ABS_X] = WIDE_AXIS_MAX;
+	wide.abs_max[ABS_Z] = 4095;
+
+	for (Device& device : devices) setup_cache(device);
+	return devices;
+}
+
+int main(int argc, char** argv) {
+	const std::vector<Device> devices = build_devices();
+	const std::vector<StreamEvent> stream = build_stream();
+
+	// both paths have to forward exactly the same events, axes may differ by one from rounding
+	uint64_t forwarded = 0;
+	int32_t maxAxisError = 0;
+	for (const StreamEvent& e : stream) {
+		LinuxInputEvent legacy, cached;
+		const bool legacyKept = legacy_decode(&devices[e.device].fake, e.ev, legacy);
+		const bool cachedKept = decode_event(devices[e.device].cached, e.ev, cached);
+		if (legacyKept != cachedKept || (legacyKept && (legacy.time != cached.time || legacy.type != cached.type
+			|| legacy.code != cached.code || legacy.deviceType != cached.deviceType))) {
+			std::fprintf(stderr, "decode mismatch on device %u type %u code %u\n", e.device, e.ev.type, e.ev.code);
+			return 1;
+		}
+		if (legacyKept) {
+			forwarded++;
+			maxAxisError = std::max(maxAxisError, std::abs(legacy.value - cached.value));
+		}
+	}
+
+	std::printf("%zu events over %ds (%d Hz mouse), %llu forwarded, max axis difference %d\n", stream.size(), SECONDS, MOUSE_HZ,
+		static_cast<unsigned long long>(forwarded), maxAxisError);
+	if (maxAxisError > 1) {
+		std::fprintf(stderr, "axes differ by %d from the old scaling, more than rounding can explain\n", maxAxisError);
+		return 1;
+	}
+
+	// full scale has to reach the real endpoints, not one short of them
+	for (const Device& device : devices) {
+		if (device.cached.type != CONTROLLER) continue;
+		for (unsigned int code = 0; code < ABS_CNT; code++) {
+			if (!device.fake.axes.test(code)) continue;
+			const bool trigger = code == ABS_Z || code == ABS_RZ;
+			const int32_t low = scale_axis(device.cached.axes[code], device.fake.abs_min[code]);
+			const int32_t high = scale_axis(device.cached.axes[code], device.fake.abs_max[code]);
+			if (low != (trigger ? 0 : -32768) || high != (trigger ? 255 : 32767)) {
+				std::fprintf(stderr, "axis %u maps [%d, %d] to [%d, %d]\n", code, device.fake.abs_min[code], device.fake.abs_max[code], low, high);
+				return 1;
+			}
+		}
+	}
+	if (checkOnly(argc, argv)) return 0;
+
+	auto time = [&](const char* name, auto&& decode) {
+		int64_t best = INT64_MAX;
+		for (int round = 0; round < ROUNDS; round++) {
+			const int64_t start = nowNs();
+			for (const StreamEvent& e : stream) {
+				LinuxInputEvent out;
+				if (decode(devices[e.device], e.ev, out)) doNotOptimize(out);
+			}
+			best = std::min(best, nowNs() - start);
+		}
+		std::printf("%-24s %8.2f ns/event\n", name, static_cast<double>(best) / stream.size());
+	};
+
+	time("per-event classification", [](const Device& device, const input_event& ev, LinuxInputEvent& out) {
+		return legacy_decode(&device.fake, ev, out);
+	});
+	time("per-device cache", [](const Device& device, const input_event& ev, LinuxInputEvent& out) {
+		return decode_event(device.cached, ev, out);
+	});
+	return 0;
+}
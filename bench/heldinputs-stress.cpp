@@ -0,0 +1,134 @@
+// several producers hammering press/release on the held input bitset, checks every edge is reported once
+
+#include "bench.hpp"
+
+#include "core/heldinputs.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+constexpr int PRODUCERS = 4;
+constexpr int OPERATIONS = 2'000'000;
+
+// keys every producer fights over, all in the same two words
+constexpr uint16_t SHARED_KEYS[] = { 32, 33, 38, 63, 64, 65 };
+
+struct Counts {
+	uint64_t presses = 0;
+	uint64_t releases = 0;
+};
+
+/*
+Each producer owns a few keys next to everyone else's (so they share words) and also races on SHARED_KEYS.
+For owned keys the producer knows the exact state, so every press/release result is checked.
+For shared keys, successful presses minus successful releases has to equal the final state.
+*/
+bool stress(HeldInputs& held) {
+	std::vector<std::array<Counts, std::size(SHARED_KEYS)>> shared(PRODUCERS);
+	std::atomic<uint64_t> wrongEdges{ 0 };
+	std::atomic<bool> go{ false };
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < PRODUCERS; p++) {
+		threads.emplace_back([&, p]() {
+			std::mt19937 rng(p + 1);
+			std::array<bool, 16> ownedState{};
+			uint64_t wrong = 0;
+
+			while (!go.load()) std::this_thread::yield();
+
+			for (int i = 0; i < OPERATIONS; i++) {
+				const uint32_t r = rng();
+				const bool pressing = r & 1;
+
+				if (r & 2) {
+					// owned keys are interleaved with the other producers' in the same words
+					const int slot = (r >> 2) % ownedState.size();
+					const uint16_t key = static_cast<uint16_t>(1024 + slot * PRODUCERS + p);
+					const bool edge = pressing ? held.press(key) : held.release(key);
+					if (edge != (ownedState[slot] != pressing)) wrong++;
+					ownedState[slot] = pressing;
+				}
+				else {
+					const size_t index = (r >> 2) % std::size(SHARED_KEYS);
+					if (pressing ? held.press(SHARED_KEYS[index]) : held.release(SHARED_KEYS[index])) {
+						(pressing ? shared[p][index].presses : shared[p][index].releases)++;
+					}
+				}
+			}
+
+			for (size_t slot = 0; slot < ownedState.size(); slot++) {
+				const uint16_t key = static_cast<uint16_t>(1024 + slot * PRODUCERS + p);
+				if (held.contains(key) != ownedState[slot]) wrong++;
+			}
+			wrongEdges.fetch_add(wrong);
+		});
+	}
+
+	const int64_t start = nowNs();
+	go.store(true);
+	for (auto& t : threads) t.join();
+	const int64_t elapsed = nowNs() - start;
+
+	bool ok = wrongEdges.load() == 0;
+	for (size_t index = 0; index < std::size(SHARED_KEYS); index++) {
+		int64_t balance = 0;
+		for (int p = 0; p < PRODUCERS; p++) balance += static_cast<int64_t>(shared[p][index].presses) - static_cast<int64_t>(shared[p][index].releases);
+		if (balance != (held.contains(SHARED_KEYS[index]) ? 1 : 0)) {
+			std::printf("shared key %u: %lld unmatched edges\n", SHARED_KEYS[index], static_cast<long long>(balance));
+			ok = false;
+		}
+	}
+
+	std::printf("%d producers x %d operations: %llu wrong edges, %.1f ns/operation per producer\n", PRODUCERS, OPERATIONS,
+		static_cast<unsigned long long>(wrongEdges.load()), static_cast<double>(elapsed) / OPERATIONS);
+	return ok;
+}
+
+// single-threaded cost of the edge check, against the unordered_set it replaced (which also needed a lock to be safe)
+void compare() {
+	std::mt19937 rng(3);
+	std::vector<uint16_t> keys(OPERATIONS);
+	for (uint16_t& key : keys) key = static_cast<uint16_t>(rng() % 64 + 1000);
+
+	std::unordered_set<uint16_t> set;
+	std::mutex lock;
+	const uint64_t allocsBefore = allocationCount();
+	int64_t start = nowNs();
+	for (size_t i = 0; i < keys.size(); i++) {
+		std::lock_guard guard(lock);
+		if (i & 1) {
+			if (set.contains(keys[i])) set.erase(keys[i]);
+		}
+		else if (!set.contains(keys[i])) {
+			set.emplace(keys[i]);
+		}
+	}
+	const double setNs = static_cast<double>(nowNs() - start) / keys.size();
+	const uint64_t setAllocs = allocationCount() - allocsBefore;
+
+	auto held = std::make_unique<HeldInputs>();
+	const uint64_t bitsAllocsBefore = allocationCount();
+	start = nowNs();
+	for (size_t i = 0; i < keys.size(); i++) {
+		doNotOptimize(i & 1 ? held->release(keys[i]) : held->press(keys[i]));
+	}
+	const double bitsNs = static_cast<double>(nowNs() - start) / keys.size();
+	const uint64_t bitsAllocs = allocationCount() - bitsAllocsBefore;
+
+	std::printf("%-24s %8.2f ns/edge, %llu allocations\n", "mutex + unordered_set", setNs, static_cast<unsigned long long>(setAllocs));
+	std::printf("%-24s %8.2f ns/edge, %llu allocations\n", "atomic bitset", bitsNs, static_cast<unsigned long long>(bitsAllocs));
+}
+
+int main(int argc, char** argv) {
+	auto held = std::make_unique<HeldInputs>();
+	if (!stress(*held)) return 1;
+	if (!checkOnly(argc, argv)) compare();
+	return 0;
+}
@@ -0,0 +1,144 @@
+// producer push cost and main-thread drain cost: one locked deque vs per-producer lanes
+
+#include "bench.hpp"
+
+#include "core/scheduler.hpp"
+#include "core/inputlanes.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// each producer behaves like an 8 kHz device: a burst of 8 events every millisecond
+constexpr int BURST = 8;
+constexpr auto BURST_INTERVAL = std::chrono::milliseconds(1);
+constexpr auto FRAME_INTERVAL = std::chrono::microseconds(1'000'000 / 360);
+constexpr auto RUN_TIME = std::chrono::milliseconds(1500);
+
+struct Stats {
+	double pushNs;
+	double drainNsPerFrame;
+	uint64_t drained;
+	uint64_t dropped;
+};
+
+struct LockedQueue {
+	std::deque<InputEvent> queue;
+	std::mutex lock;
+
+	bool push(InputLane, const InputEvent& input) {
+		std::lock_guard guard(lock);
+		queue.emplace_back(input);
+		return true;
+	}
+
+	size_t drain(TimestampType cutoff, std::deque<InputEvent>& out) {
+		std::lock_guard guard(lock);
+		size_t n = 0;
+		while (!queue.empty() && queue.front().time <= cutoff) {
+			out.push_back(queue.front());
+			queue.pop_front();
+			n++;
+		}
+		return n;
+	}
+};
+
+struct Lanes {
+	std::unique_ptr<InputLanes> lanes = std::make_unique<InputLanes>();
+
+	bool push(InputLane lane, const InputEvent& input) {
+		return lanes->push(lane, input);
+	}
+
+	size_t drain(TimestampType cutoff, std::deque<InputEvent>& out) {
+		size_t n = 0;
+		InputEvent input;
+		while (lanes->popOldest(cutoff, input)) {
+			out.push_back(input);
+			n++;
+		}
+		return n;
+	}
+};
+
+template <typename Queue>
+Stats run(int producers) {
+	Queue queue;
+	std::atomic<bool> done{ false };
+	std::atomic<int64_t> pushNs{ 0 };
+	std::atomic<uint64_t> pushes{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producers; p++) {
+		threads.emplace_back([&, p]() {
+			const InputLane lane = static_cast<InputLane>(p % INPUT_LANE_COUNT);
+			auto next = std::chrono::steady_clock::now();
+			int64_t total = 0;
+			uint64_t count = 0;
+
+			while (!done.load(std::memory_order_relaxed)) {
+				for (int i = 0; i < BURST; i++) {
+					const int64_t start = nowNs();
+					if (!queue.push(lane, InputEvent{ start, InputButton::Jump, (i & 1) == 0, true })) dropped.fetch_add(1);
+					total += nowNs() - start;
+					count++;
+				}
+				next += BURST_INTERVAL;
+				std::this_thread::sleep_until(next);
+			}
+
+			pushNs.fetch_add(total);
+			pushes.fetch_add(count);
+		});
+	}
+
+	std::deque<InputEvent> out;
+	int64_t drainNs = 0;
+	uint64_t frames = 0;
+	uint64_t drained = 0;
+
+	const auto end = std::chrono::steady_clock::now() + RUN_TIME;
+	auto next = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() < end) {
+		const int64_t frameStart = nowNs();
+		drained += queue.drain(frameStart, out);
+		drainNs += nowNs() - frameStart;
+		out.clear();
+		frames++;
+
+		next += FRAME_INTERVAL;
+		std::this_thread::sleep_until(next);
+	}
+
+	done.store(true);
+	for (auto& t : threads) t.join();
+	drained += queue.drain(std::numeric_limits<TimestampType>::max(), out);
+
+	return Stats{
+		static_cast<double>(pushNs.load()) / static_cast<double>(pushes.load()),
+		static_cast<double>(drainNs) / frames,
+		drained,
+		dropped.load(),
+	};
+}
+
+int main() {
+	std::printf("%-12s %10s %10s %16s %10s %10s\n", "queue", "producers", "ns/push", "ns/drain frame", "drained", "dropped");
+	auto print = [](const char* name, int producers, const Stats& stats) {
+		std::printf("%-12s %10d %10.1f %16.1f %10llu %10llu\n", name, producers, stats.pushNs, stats.drainNsPerFrame,
+			static_cast<unsigned long long>(stats.drained), static_cast<unsigned long long>(stats.dropped));
+	};
+
+	for (int producers : { 1, 2, 3 }) {
+		print("mutex+deque", producers, run<LockedQueue>(producers));
+		print("spsc lanes", producers, run<Lanes>(producers));
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+// cost of finding the action bound to a key: six hash sets behind a mutex vs the flat table
+
+#include "bench.hpp"
+
+#include "core/keybinds.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+constexpr int LOOKUPS = 2'000'000;
+constexpr int ROUNDS = 10;
+
+// what the input threads used to do for every event
+struct HashSetBinds {
+	std::array<std::unordered_set<size_t>, KEY_ACTION_COUNT> inputBinds;
+	mutable std::mutex keybindsLock;
+
+	bool lookup(size_t key, InputButton& button, bool& player1) const {
+		std::lock_guard lock(keybindsLock);
+
+		player1 = true;
+		if (inputBinds[0].contains(key)) button = InputButton::Jump;
+		else if (inputBinds[1].contains(key)) button = InputButton::Left;
+		else if (inputBinds[2].contains(key)) button = InputButton::Right;
+		else {
+			player1 = false;
+			if (inputBinds[3].contains(key)) button = InputButton::Jump;
+			else if (inputBinds[4].contains(key)) button = InputButton::Left;
+			else if (inputBinds[5].contains(key)) button = InputButton::Right;
+			else return false;
+		}
+		return true;
+	}
+};
+
+int main() {
+	// a typical setup: a few keys per action, controller buttons on p1 jump
+	KeyBindings::Binds binds = {{
+		{ 32, 87, 38, 1000, 1001 }, // space, w, up, controller a/b
+		{ 65, 37 },
+		{ 68, 39 },
+		{ 73 },
+		{ 74 },
+		{ 76 },
+	}};
+
+	HashSetBinds hashSets;
+	for (size_t action = 0; action < KEY_ACTION_COUNT; action++) {
+		hashSets.inputBinds[action].insert(binds[action].begin(), binds[action].end());
+	}
+
+	auto table = std::make_unique<KeyBindings>();
+	table->update(binds);
+
+	// mostly bound keys, like a player mashing jump, with some typing mixed in
+	std::mt19937 rng(7);
+	std::vector<size_t> keys(LOOKUPS);
+	for (size_t& key : keys) key = rng() % 4 ? binds[rng() % KEY_ACTION_COUNT][0] : rng() % 256;
+
+	uint64_t mismatches = 0;
+	for (size_t key : keys) {
+		InputButton a{}, b{};
+		bool p1a = false, p1b = false;
+		const bool boundA = hashSets.lookup(key, a, p1a);
+		const bool boundB = table->lookup(key, b, p1b);
+		if (boundA != boundB || (boundA && (a != b || p1a != p1b))) mismatches++;
+	}
+	std::printf("%d lookups, %llu mismatches\n", LOOKUPS, static_cast<unsigned long long>(mismatches));
+
+	auto time = [&](const char* name, const auto& binds) {
+		int64_t best = INT64_MAX;
+		for (int round = 0; round < ROUNDS; round++) {
+			const int64_t start = nowNs();
+			for (size_t key : keys) {
+				InputButton button;
+				bool player1;
+				if (binds.lookup(key, button, player1)) doNotOptimize(button);
+			}
+			best = std::min(best, nowNs() - start);
+		}
+		std::printf("%-22s %8.2f ns/lookup\n", name, static_cast<double>(best) / LOOKUPS);
+	};
+
+	time("mutex + 6 hash sets", hashSets);
+	time("flat table", *table);
+
+	return mismatches ? 1 : 0;
+}
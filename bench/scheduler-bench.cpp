@@ -0,0 +1,358 @@
+// per-frame cost of the step scheduler (drain + build + consume) at various refresh rates and input loads
+
+#include "bench.hpp"
+
+#include "core/scheduler.hpp"
+#include "core/inputlanes.hpp"
+#include "core/metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+constexpr TimestampType TICKS_PER_SECOND = 10'000'000; // same resolution as QPC on most machines
+
+struct Workload {
+	const char* name;
+	int fps;
+	int inputsPerFrame;
+	bool physicsBypass;
+	double hitchSeconds; // every HITCH_INTERVAL frames, one frame takes this long
+	bool metrics = false; // record into StepMetrics like the mod does with "record-metrics" on
+	float timewarp = 1.0f; // below 1 multiplies the step count, e.g. 0.1 runs 10x as many steps per frame
+};
+
+constexpr int FRAMES = 20'000;
+
+constexpr int HITCH_INTERVAL = 500;
+
+struct Result {
+	double nsPerFrame;
+	double allocsPerFrame;
+	double stepsPerFrame;
+	double latencyP50Us; // frame start to input, measured against the virtual clock so it is exact
+	double latencyMaxUs;
+};
+
+Result run(const Workload& w) {
+	StepScheduler s;
+	StepCountState state;
+	state.physicsBypass = w.physicsBypass;
+	state.animationInterval = 1.0 / w.fps;
+
+	auto lanes = std::make_unique<InputLanes>();
+	std::mt19937_64 rng(1234);
+
+	auto metrics = std::make_unique<StepMetrics>();
+	metrics->nsPerTick = 1e9 / TICKS_PER_SECOND;
+	if (w.metrics) s.metrics = metrics.get();
+
+	// frames take exactly as long as the workload says, no matter how fast this machine runs them
+	VirtualClock clock(TICKS_PER_SECOND, TICKS_PER_SECOND);
+	s.clock = &clock;
+
+	const double frameSeconds = 1.0 / w.fps;
+
+	int64_t totalNs = 0;
+	uint64_t totalAllocs = 0;
+	uint64_t totalSteps = 0;
+	uint64_t dispatched = 0;
+
+	for (int frame = 0; frame < FRAMES; frame++) {
+		const double delta = (w.hitchSeconds > 0.0 && frame % HITCH_INTERVAL == HITCH_INTERVAL - 1) ? w.hitchSeconds : frameSeconds;
+		const TimestampType deltaTicks = static_cast<TimestampType>(delta * TICKS_PER_SECOND);
+
+		std::uniform_int_distribution<TimestampType> offset(1, deltaTicks);
+		std::vector<TimestampType> times(w.inputsPerFrame);
+		for (auto& t : times) t = clock.now() + offset(rng);
+		std::sort(times.begin(), times.end());
+		for (size_t i = 0; i < times.size(); i++) {
+			lanes->push(i % 3 == 0 ? XinputLane : RawInputLane, InputEvent{ times[i], InputButton::Jump, (i & 1) == 0, true });
+		}
+
+		clock.advance(deltaTicks);
+		markFrameTime(s);
+
+		const uint64_t allocsBefore = allocationCount();
+		const int64_t start = nowNs();
+
+		const int stepCount = calculateStepCount(state, static_cast<float>(delta), w.timewarp, false);
+		drainInputs(s, *lanes, false, frameInputLimit(s));
+		buildStepQueue(s, stepCount);
+		while (hasNextStep(s)) {
+			Step step = popStepQueue(s, [&](const InputEvent&) { dispatched++; });
+			doNotOptimize(step);
+		}
+
+		totalNs += nowNs() - start;
+		totalAllocs += allocationCount() - allocsBefore;
+		totalSteps += stepCount;
+	}
+
+	doNotOptimize(dispatched);
+
+	return Result{
+		static_cast<double>(totalNs) / FRAMES,
+		static_cast<double>(totalAllocs) / FRAMES,
+		static_cast<double>(totalSteps) / FRAMES,
+		metrics->inputLatencyNs.percentile(0.5) / 1000.0,
+		metrics->inputLatencyNs.max() / 1000.0,
+	};
+}
+
+// the StepPlan from before run-length plans, one entry per step
+class FlatPlan {
+public:
+	FlatPlan() {
+		m_steps.reserve(2048);
+	}
+
+	bool empty() const {
+		return m_head == m_steps.size();
+	}
+
+	const Step& front() const {
+		return m_steps[m_head];
+	}
+
+	void pop_front() {
+		m_head++;
+	}
+
+	void push_back(const Step& step) {
+		m_steps.push_back(step);
+	}
+
+	void clear() {
+		m_steps.clear();
+		m_head = 0;
+	}
+
+private:
+	std::vector<Step> m_steps;
+	size_t m_head = 0;
+};
+
+/*
+Plan and consume cost of a frame without inputs. Consuming still takes one pop per step,
+since GD calls PlayerObject::update for each of them and the hook pops plain steps with pop_front.
+*/
+constexpr int PLAN_FRAMES = 100'000;
+constexpr int PLAN_ROUNDS = 15;
+
+// one pass of PLAN_FRAMES frames, in ns per frame
+template <typename Plan, typename Build>
+double planPass(Plan& plan, Build&& build) {
+	const int64_t start = nowNs();
+	for (int frame = 0; frame < PLAN_FRAMES; frame++) {
+		build();
+		while (!plan.empty()) {
+			doNotOptimize(plan.front().endStep);
+			plan.pop_front();
+		}
+	}
+	return static_cast<double>(nowNs() - start) / PLAN_FRAMES;
+}
+
+/*
+Cost of the frames around a freeze, with clicks at CLICK_HZ and a button chattering at CHATTER_HZ
+for the whole freeze. Eager plans the whole frame in buildStepQueue like it used to,
+lazy leaves the rest to popStepQueue and hitch frames only take CATCH_UP_INPUTS of the backlog.
+The rest of the backlog is then taken CATCH_UP_INPUTS at a time by the frames after the hitch,
+so lazy moves that cost out of the hitch frame rather than saving it, which the catch-up columns show.
+*/
+constexpr int HITCH_ROUNDS = 200;
+constexpr int HITCH_FPS = 360;
+constexpr int CLICK_HZ = 20;
+constexpr int CHATTER_HZ = 500;
+
+// substeps of a step are fractions of it, whatever the inputs were they have to add up to the whole step
+constexpr double FACTOR_SUM_TOLERANCE = 1e-4;
+
+struct HitchResult {
+	double upFrontNs;
+	double worstStepNs;
+	double totalNs;
+	size_t inputs;
+	int catchUpFrames; // frames after the hitch until its backlog is gone
+	double worstCatchUpNs;
+	double catchUpNs; // all of those frames together
+	double worstFactorError; // furthest any step's factors summed from 1
+};
+
+HitchResult hitchFrame(double hitchSeconds, bool eager, int rounds) {
+	HitchResult best{ 1e18, 1e18, 1e18, 0, 0, 1e18, 1e18, 0.0 };
+
+	for (int round = 0; round < rounds; round++) {
+		StepScheduler s;
+		VirtualClock clock(TICKS_PER_SECOND);
+		s.clock = &clock;
+		auto lanes = std::make_unique<InputLanes>();
+
+		// one normal frame to get out of firstFrame
+		s.currentFrameTime = TICKS_PER_SECOND;
+		buildStepQueue(s, 1);
+
+		const TimestampType start = s.currentFrameTime;
+		const TimestampType length = static_cast<TimestampType>(hitchSeconds * TICKS_PER_SECOND);
+		const TimestampType clickEvery = TICKS_PER_SECOND / CLICK_HZ;
+		const TimestampType chatterEvery = TICKS_PER_SECOND / CHATTER_HZ;
+		for (TimestampType t = chatterEvery; t < length; t += chatterEvery) {
+			lanes->push(XinputLane, InputEvent{ start + t, InputButton::Right, (t / chatterEvery) % 2 == 0, false });
+			if (t % clickEvery < chatterEvery) lanes->push(RawInputLane, InputEvent{ start + t, InputButton::Jump, (t / clickEvery) % 2 == 0, true });
+		}
+
+		uint64_t dispatched = 0;
+		double factorSum = 0.0;
+		auto popStep = [&]() {
+			Step step = popStepQueue(s, [&](const InputEvent&) { dispatched++; });
+			factorSum += step.deltaFactor;
+			if (step.endStep) {
+				best.worstFactorError = std::max(best.worstFactorError, std::abs(factorSum - 1.0));
+				factorSum = 0.0;
+			}
+		};
+
+		s.currentFrameTime = start + length;
+		const int stepCount = calculateStepCount(*std::make_unique<StepCountState>(), static_cast<float>(hitchSeconds), 1.0f, false);
+
+		const int64_t begin = nowNs();
+		drainInputs(s, *lanes, false, eager ? MAX_FRAME_INPUTS : frameInputLimit(s));
+		buildStepQueue(s, stepCount);
+		if (eager) while (planNextSteps(s)) {}
+		const int64_t planned = nowNs();
+
+		int64_t worstStep = 0;
+		int64_t last = planned;
+		while (hasNextStep(s)) {
+			popStep();
+			const int64_t now = nowNs();
+			worstStep = std::max(worstStep, now - last);
+			last = now;
+		}
+		const size_t inputs = s.inputCount;
+
+		int catchUpFrames = 0;
+		int64_t worstCatchUp = 0;
+		int64_t catchUp = 0;
+		do {
+			s.currentFrameTime += TICKS_PER_SECOND / HITCH_FPS;
+			const int64_t frameBegin = nowNs();
+			drainInputs(s, *lanes, false, frameInputLimit(s));
+			buildStepQueue(s, 1);
+			while (hasNextStep(s)) popStep();
+			const int64_t frameNs = nowNs() - frameBegin;
+
+			catchUpFrames++;
+			worstCatchUp = std::max(worstCatchUp, frameNs);
+			catchUp += frameNs;
+		} while (s.catchingUp);
+		doNotOptimize(dispatched);
+
+		best.upFrontNs = std::min(best.upFrontNs, static_cast<double>(planned - begin));
+		best.worstStepNs = std::min(best.worstStepNs, static_cast<double>(worstStep));
+		best.totalNs = std::min(best.totalNs, static_cast<double>(last - begin));
+		best.inputs = inputs;
+		best.catchUpFrames = catchUpFrames;
+		best.worstCatchUpNs = std::min(best.worstCatchUpNs, static_cast<double>(worstCatchUp));
+		best.catchUpNs = std::min(best.catchUpNs, static_cast<double>(catchUp));
+	}
+	return best;
+}
+
+constexpr double HITCHES[] = { 1.0 / HITCH_FPS, 0.05, 0.25, 1.0 };
+
+int main(int argc, char** argv) {
+	for (double hitch : HITCHES) {
+		for (bool eager : { true, false }) {
+			const HitchResult r = hitchFrame(hitch, eager, 1);
+			if (r.worstFactorError > FACTOR_SUM_TOLERANCE) {
+				std::fprintf(stderr, "%.0fms hitch, %s plan: a step's factors are %g off from summing to 1\n", hitch * 1000.0, eager ? "eager" : "lazy", r.worstFactorError);
+				return 1;
+			}
+		}
+	}
+	std::printf("every step's factors sum to 1 around every hitch\n\n");
+	if (checkOnly(argc, argv)) return 0;
+
+	std::vector<Workload> workloads;
+
+	for (bool bypass : { false, true }) {
+		for (int fps : { 60, 144, 240, 360, 540 }) {
+			for (int inputs : { 0, 1, 4, 16, 50 }) {
+				workloads.push_back(Workload{ bypass ? "2.2 bypass" : "vanilla", fps, inputs, bypass, 0.0 });
+			}
+		}
+	}
+	for (int inputs : { 0, 4, 50 }) {
+		workloads.push_back(Workload{ "metrics", 360, inputs, false, 0.0, true });
+	}
+	for (int fps : { 1000, 2000, 4000, 8000 }) {
+		workloads.push_back(Workload{ "metrics", fps, 1, false, 0.0, true });
+	}
+	for (float timewarp : { 0.1f, 0.02f }) {
+		for (int inputs : { 0, 1, 4 }) {
+			workloads.push_back(Workload{ "slow bypass", 540, inputs, true, 0.0, false, timewarp });
+		}
+	}
+	for (double hitch : { 0.05, 0.25, 1.0 }) {
+		workloads.push_back(Workload{ "hitch", 360, 4, false, hitch });
+		workloads.push_back(Workload{ "hitch", 360, 50, false, hitch });
+	}
+
+	std::printf("%-12s %5s %7s %8s %10s %12s %12s\n", "mode", "fps", "inputs", "hitch", "steps", "ns/frame", "allocs/frame");
+	for (const Workload& w : workloads) {
+		Result r = run(w);
+		std::printf("%-12s %5d %7d %7.0fms %10.2f %12.1f %12.2f", w.name, w.fps, w.inputsPerFrame, w.hitchSeconds * 1000.0, r.stepsPerFrame, r.nsPerFrame, r.allocsPerFrame);
+		if (w.metrics && w.inputsPerFrame) {
+			std::printf("   latency p50 %.1fus max %.1fus", r.latencyP50Us, r.latencyMaxUs);
+
+			// every input is from within the frame it is planned in, so nothing can wait longer than one frame
+			if (r.latencyMaxUs > 1e6 / w.fps) {
+				std::printf("\nlatency above one frame at %d fps\n", w.fps);
+				return 1;
+			}
+		}
+		std::printf("\n");
+	}
+
+	std::printf("\nframes without inputs, plan + consume\n%10s %14s %14s\n", "steps", "flat ns", "run-length ns");
+	for (int stepCount : { 1, 4, 16, 60, 240, 1000 }) {
+		auto flat = std::make_unique<FlatPlan>();
+		auto s = std::make_unique<StepScheduler>();
+		s->firstFrame = false;
+
+		// alternating the two, so a frequency change or a noisy neighbour hits both
+		double flatNs = 1e18;
+		double runNs = 1e18;
+		for (int round = 0; round < PLAN_ROUNDS; round++) {
+			flatNs = std::min(flatNs, planPass(*flat, [&]() {
+				flat->clear();
+				for (int i = 0; i < stepCount; i++) flat->push_back(EMPTY_STEP);
+			}));
+			runNs = std::min(runNs, planPass(s->stepQueue, [&]() {
+				s->currentFrameTime += TICKS_PER_SECOND / 60;
+				buildStepQueue(*s, stepCount);
+			}));
+		}
+
+		std::printf("%10d %14.1f %14.1f\n", stepCount, flatNs, runNs);
+	}
+
+	std::printf("\nframes around a freeze at %d fps, %d Hz clicks and %d Hz chatter during it, best of %d\n", HITCH_FPS, CLICK_HZ, CHATTER_HZ, HITCH_ROUNDS);
+	std::printf("%8s %6s %7s %14s %14s %14s %8s %8s %16s %14s\n", "hitch", "plan", "steps", "up front ns", "worst step ns", "total ns", "inputs",
+		"frames", "worst after ns", "catch-up ns");
+	for (double hitch : HITCHES) {
+		const int stepCount = calculateStepCount(*std::make_unique<StepCountState>(), static_cast<float>(hitch), 1.0f, false);
+		for (bool eager : { true, false }) {
+			const HitchResult r = hitchFrame(hitch, eager, HITCH_ROUNDS);
+			std::printf("%6.0fms %6s %7d %14.0f %14.0f %14.0f %8zu %8d %16.0f %14.0f\n", hitch * 1000.0, eager ? "eager" : "lazy", stepCount,
+				r.upFrontNs, r.worstStepNs, r.totalNs, r.inputs, r.catchUpFrames, r.worstCatchUpNs, r.catchUpNs);
+		}
+	}
+
+	return 0;
+}
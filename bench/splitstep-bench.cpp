@@ -0,0 +1,274 @@
+// the PlayerObject::update split path on stub players: the loop the hook used to run inline vs SplitStep
+
+#include "bench.hpp"
+
+#include "core/splitstep.hpp"
+#include "core/inputlanes.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+constexpr TimestampType TICKS_PER_SECOND = 10'000'000;
+constexpr int FRAMES = 20'000;
+constexpr int ROUNDS = 5;
+
+/*
+Just enough of a PlayerObject to exercise every branch of the split loop: gravity, landing,
+jumps from dispatched inputs, and a collision log that only fills up on the ground.
+Calls into "the game" are out of line like they are in the real thing.
+*/
+struct StubPlayer {
+	float y = 0.0f;
+	float yVelocity = 0.0f;
+	bool isOnGround = true;
+	bool isUpsideDown = false;
+	bool isShip = false;
+	int touchingRings = 0;
+	std::vector<int> collisionLog[4];
+	int lastCollision[4] = { -1, -1, -1, -1 };
+
+	__attribute__((noinline)) void update(float delta) {
+		yVelocity -= 2.0f * delta;
+		y += yVelocity * delta;
+		if (y <= 0.0f) {
+			y = 0.0f;
+			yVelocity = 0.0f;
+			isOnGround = true;
+		}
+	}
+
+	__attribute__((noinline)) void updateRotation(float delta) {
+		doNotOptimize(delta);
+	}
+
+	__attribute__((noinline)) void checkCollisions(float delta) {
+		doNotOptimize(delta);
+		if (y == 0.0f) {
+			collisionLog[3].push_back(1);
+			lastCollision[3] = 1;
+		}
+	}
+
+	__attribute__((noinline)) static void removeAllObjects(std::vector<int>& log) {
+		log.clear();
+	}
+
+	void jump() {
+		if (!isOnGround) return;
+		yVelocity = 1.0f;
+		isOnGround = false;
+	}
+};
+
+// the same shape as GameSplitPlayer in main.cpp
+struct StubSplitPlayer {
+	StubPlayer* player;
+
+	bool onGround() const { return player->isOnGround; }
+	void setOnGround(bool onGround) { player->isOnGround = onGround; }
+	bool notBuffering() const { return player->isOnGround || player->touchingRings || player->isShip; }
+	bool fallingTowardGround() const { return (player->yVelocity < 0) ^ player->isUpsideDown; }
+	void update(float delta) { player->update(delta); }
+	void updateRotation(float delta) { player->updateRotation(delta); }
+	void checkCollisions(float delta) { player->checkCollisions(delta); }
+
+	bool collisionLogClean() const {
+		for (int i = 0; i < 4; i++) {
+			if (!player->collisionLog[i].empty() || player->lastCollision[i] != -1) return false;
+		}
+		return true;
+	}
+
+	void resetCollisionLog() {
+		for (int i = 0; i < 4; i++) {
+			StubPlayer::removeAllObjects(player->collisionLog[i]);
+			player->lastCollision[i] = -1;
+		}
+	}
+};
+
+struct StubLayer {
+	StubPlayer p1;
+	StubPlayer p2;
+	bool isDualMode = false;
+	uint64_t buttons = 0;
+
+	void handleButton(const InputEvent& input) {
+		buttons++;
+		if (input.inputState) (input.isPlayer1 ? p1 : p2).jump();
+	}
+};
+
+// PlayLayer::get() goes through GameManager, the old loop did that once per pop
+StubLayer* currentLayer = nullptr;
+
+__attribute__((noinline)) StubLayer* getLayer() {
+	return currentLayer;
+}
+
+// what the PlayerObject::update hook ran inline before SplitStep
+void legacySplitStep(StepScheduler& s, SplitStepState& state, StubLayer* layer, float stepDelta) {
+	StubSplitPlayer p1{ &layer->p1 };
+	StubSplitPlayer p2{ &layer->p2 };
+	const bool isDual = layer->isDualMode;
+	const bool p1StartedOnGround = p1.onGround();
+	const bool p2StartedOnGround = p2.onGround();
+	const bool p1NotBuffering = p1.notBuffering();
+	const bool p2NotBuffering = p2.notBuffering();
+
+	state.p1Split = p1NotBuffering;
+	state.p2Split = p2NotBuffering && isDual;
+
+	Step step;
+	bool firstLoop = true;
+	state.midStep = true;
+
+	do {
+		step = popStepQueue(s, [](const InputEvent& input) { getLayer()->handleButton(input); });
+		const float substepDelta = stepDelta * step.deltaFactor;
+		state.rotationDelta = substepDelta;
+
+		if (state.p1Split) {
+			p1.update(substepDelta);
+			if (!step.endStep) {
+				if (firstLoop && p1.fallingTowardGround()) p1.setOnGround(p1StartedOnGround);
+				p1.checkCollisions(stepDelta);
+				p1.updateRotation(substepDelta);
+				p1.resetCollisionLog();
+			}
+		}
+		else if (step.endStep) p1.update(stepDelta);
+
+		if (state.p2Split) {
+			p2.update(substepDelta);
+			if (!step.endStep) {
+				if (firstLoop && p2.fallingTowardGround()) p2.setOnGround(p2StartedOnGround);
+				p2.checkCollisions(stepDelta);
+				p2.updateRotation(substepDelta);
+				p2.resetCollisionLog();
+			}
+		}
+		else if (step.endStep) p2.update(stepDelta);
+
+		firstLoop = false;
+	} while (!step.endStep);
+
+	state.midStep = false;
+}
+
+void newSplitStep(StepScheduler& s, Timeline& timeline, SplitStepState& state, StubLayer* layer, float stepDelta) {
+	StubSplitPlayer p1{ &layer->p1 };
+	StubSplitPlayer p2{ &layer->p2 };
+	auto dispatch = [layer](const InputEvent& input) { layer->handleButton(input); };
+	SplitStep(s, timeline, state, p1, p2, dispatch).run(stepDelta, layer->isDualMode);
+}
+
+struct Workload {
+	const char* name;
+	int fps;
+	int inputsPerFrame;
+	bool dual;
+};
+
+struct FrameLog {
+	std::vector<float> state; // both players' y and velocity after every frame
+	uint64_t buttons = 0;
+};
+
+/*
+Runs the game's side of a frame: GD calls update once per step, the hook either pops a plain step
+or runs the split path. Returns the best time over ROUNDS in ns per frame.
+*/
+template <bool Legacy>
+double run(const Workload& w, FrameLog* log) {
+	int64_t best = INT64_MAX;
+
+	for (int round = 0; round < ROUNDS; round++) {
+		StepScheduler s;
+		VirtualClock clock(TICKS_PER_SECOND, TICKS_PER_SECOND);
+		s.clock = &clock;
+		auto lanes = std::make_unique<InputLanes>();
+		Timeline timeline;
+		SplitStepState state;
+		auto layer = std::make_unique<StubLayer>();
+		layer->isDualMode = w.dual;
+		layer->p2.isShip = true; // one player that can't buffer, so dual mode splits both
+		currentLayer = layer.get();
+
+		std::mt19937_64 rng(77);
+		const TimestampType frameTicks = TICKS_PER_SECOND / w.fps;
+		const int stepCount = std::max(1, 240 / w.fps);
+		const float stepDelta = 1.0f / 240.0f;
+		std::vector<TimestampType> times(w.inputsPerFrame);
+		int64_t total = 0;
+
+		for (int frame = 0; frame < FRAMES; frame++) {
+			std::uniform_int_distribution<TimestampType> offset(1, frameTicks);
+			for (auto& t : times) t = clock.now() + offset(rng);
+			std::sort(times.begin(), times.end());
+			for (size_t i = 0; i < times.size(); i++) {
+				lanes->push(RawInputLane, InputEvent{ times[i], InputButton::Jump, (i & 1) == 0, (i & 2) == 0 });
+			}
+			clock.advance(frameTicks);
+			markFrameTime(s);
+			drainInputs(s, *lanes, false, frameInputLimit(s));
+			buildStepQueue(s, stepCount);
+
+			const int64_t start = nowNs();
+			for (int i = 0; i < stepCount; i++) {
+				const bool stepPlanned = hasNextStep(s);
+				const bool inputThisStep = stepPlanned && !s.stepQueue.front().endStep;
+				if (stepPlanned && !inputThisStep) s.stepQueue.pop_front();
+
+				if (!inputThisStep) {
+					layer->p1.update(stepDelta);
+					if (w.dual) layer->p2.update(stepDelta);
+				}
+				else if constexpr (Legacy) legacySplitStep(s, state, layer.get(), stepDelta);
+				else newSplitStep(s, timeline, state, layer.get(), stepDelta);
+			}
+			total += nowNs() - start;
+
+			if (log && round == 0) {
+				log->state.insert(log->state.end(), { layer->p1.y, layer->p1.yVelocity, layer->p2.y, layer->p2.yVelocity });
+			}
+		}
+
+		if (log && round == 0) log->buttons = layer->buttons;
+		best = std::min(best, total);
+	}
+	return static_cast<double>(best) / FRAMES;
+}
+
+int main(int argc, char** argv) {
+	const Workload workloads[] = {
+		{ "60 fps, 2 inputs", 60, 2, false },
+		{ "60 fps, 8 inputs", 60, 8, false },
+		{ "60 fps, 8 inputs, dual", 60, 8, true },
+		{ "240 fps, 1 input", 240, 1, false },
+		{ "240 fps, 4 inputs, dual", 240, 4, true },
+	};
+
+	for (const Workload& w : workloads) {
+		FrameLog legacy, split;
+		run<true>(w, &legacy);
+		run<false>(w, &split);
+		if (legacy.buttons != split.buttons || legacy.state.size() != split.state.size()
+			|| std::memcmp(legacy.state.data(), split.state.data(), legacy.state.size() * sizeof(float)) != 0) {
+			std::fprintf(stderr, "%s: SplitStep diverged from the old loop\n", w.name);
+			return 1;
+		}
+	}
+	std::printf("every workload plays out identically on both loops\n\n");
+	if (checkOnly(argc, argv)) return 0;
+
+	std::printf("%-26s %12s %12s   (ns per frame, best of %d)\n", "workload", "old loop", "SplitStep", ROUNDS);
+	for (const Workload& w : workloads) {
+		std::printf("%-26s %12.1f %12.1f\n", w.name, run<true>(w, nullptr), run<false>(w, nullptr));
+	}
+	return 0;
+}
@@ -0,0 +1,193 @@
+// binning a frame's inputs into steps: the per-step loop buildStepQueue used vs the batched kernel and its vector paths
+
+#include "bench.hpp"
+
+#include "core/stepbins.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+constexpr TimestampType TICKS_PER_SECOND = 10'000'000;
+constexpr int CHECK_FRAMES = 20'000;
+constexpr int ROUNDS = 20;
+
+struct Frame {
+	std::vector<InputEvent> inputs;
+	TimestampType planStart;
+	TimestampType stepDelta;
+	int stepCount;
+};
+
+// what buildStepQueue did before the kernel, walking the steps and testing every input against each step's end
+void referenceBins(const Frame& frame, uint32_t* steps, double* fractions) {
+	size_t head = 0;
+	for (int i = 0; i < frame.stepCount; i++) {
+		while (head < frame.inputs.size()) {
+			const TimestampType offset = std::max<TimestampType>(0, frame.inputs[head].time - frame.planStart);
+			if (offset < frame.stepDelta * (i + 1)) {
+				steps[head] = static_cast<uint32_t>(i);
+				fractions[head] = static_cast<double>(offset % frame.stepDelta) / frame.stepDelta;
+				head++;
+			}
+			else break;
+		}
+	}
+}
+
+/*
+Random frames with carried inputs from before the frame, inputs after it,
+step deltas from 1 tick to several seconds and timestamps far from zero.
+*/
+Frame randomFrame(std::mt19937_64& rng, size_t count) {
+	Frame frame;
+	frame.stepCount = 1 + static_cast<int>(rng() % 300);
+	const TimestampType deltaTime = rng() % 8 == 0 ? static_cast<TimestampType>(rng() % 64) : static_cast<TimestampType>(rng() % (TICKS_PER_SECOND * 5));
+	frame.stepDelta = deltaTime / frame.stepCount + 1;
+	frame.planStart = static_cast<TimestampType>(rng() >> 4);
+
+	std::uniform_int_distribution<TimestampType> offset(-deltaTime / 4 - 10, deltaTime + deltaTime / 4 + 10);
+	frame.inputs.resize(count);
+	for (InputEvent& input : frame.inputs) input = InputEvent{ frame.planStart + offset(rng), InputButton::Jump, true, true };
+	std::sort(frame.inputs.begin(), frame.inputs.end(), [](const InputEvent& a, const InputEvent& b) { return a.time < b.time; });
+	return frame;
+}
+
+using Kernel = void (*)(const InputEvent*, size_t, TimestampType, TimestampType, uint32_t*, double*);
+
+struct NamedKernel {
+	const char* name;
+	Kernel kernel;
+};
+
+std::vector<NamedKernel> kernels() {
+	std::vector<NamedKernel> result{ { "scalar", binInputStepsScalar } };
+#ifdef CBF_STEP_BINS_X86
+	result.push_back({ "sse2", binInputStepsSse2 });
+	if (cpuHasAvx2()) result.push_back({ "avx2", binInputStepsAvx2 });
+#endif
+	result.push_back({ "dispatch", binInputSteps });
+	return result;
+}
+
+using TickKernel = void (*)(const InputEvent*, size_t, TimestampType, TimestampType, uint32_t*);
+
+struct NamedTickKernel {
+	const char* name;
+	TickKernel kernel;
+};
+
+// the steps-only paths Click on Steps bins with, they have to land every input in the same step as the full ones
+std::vector<NamedTickKernel> tickKernels() {
+	std::vector<NamedTickKernel> result{ { "scalar ticks", binInputTicksScalar } };
+#ifdef CBF_STEP_BINS_X86
+	result.push_back({ "sse2 ticks", binInputTicksSse2 });
+	if (cpuHasAvx2()) result.push_back({ "avx2 ticks", binInputTicksAvx2 });
+#endif
+	result.push_back({ "ticks", binInputTicks });
+	return result;
+}
+
+// only inputs the reference placed in the frame are compared, past the last step the kernel just reports a larger step
+bool check(const std::vector<NamedKernel>& paths, const std::vector<NamedTickKernel>& tickPaths) {
+	std::mt19937_64 rng(99);
+	std::vector<uint32_t> expectedSteps, steps, tickSteps;
+	std::vector<double> expectedFractions, fractions;
+
+	for (int f = 0; f < CHECK_FRAMES; f++) {
+		const Frame frame = randomFrame(rng, rng() % 70);
+		const size_t count = frame.inputs.size();
+		expectedSteps.assign(count, UINT32_MAX);
+		expectedFractions.assign(count, 0.0);
+		referenceBins(frame, expectedSteps.data(), expectedFractions.data());
+
+		for (const NamedKernel& path : paths) {
+			steps.assign(count, 0);
+			fractions.assign(count, 0.0);
+			path.kernel(frame.inputs.data(), count, frame.planStart, frame.stepDelta, steps.data(), fractions.data());
+
+			for (size_t i = 0; i < count; i++) {
+				if (expectedSteps[i] == UINT32_MAX) {
+					if (steps[i] < static_cast<uint32_t>(frame.stepCount)) {
+						std::fprintf(stderr, "%s: input %zu of frame %d is past the last step but was binned into step %u\n", path.name, i, f, steps[i]);
+						return false;
+					}
+					continue;
+				}
+				if (steps[i] != expectedSteps[i] || std::memcmp(&fractions[i], &expectedFractions[i], sizeof(double)) != 0) {
+					std::fprintf(stderr, "%s: input %zu of frame %d (delta %lld) got step %u fraction %.17g, expected %u %.17g\n", path.name, i, f,
+						static_cast<long long>(frame.stepDelta), steps[i], fractions[i], expectedSteps[i], expectedFractions[i]);
+					return false;
+				}
+			}
+		}
+
+		// steps is the last full path's, which matched the reference
+		for (const NamedTickKernel& path : tickPaths) {
+			tickSteps.assign(count, 0);
+			path.kernel(frame.inputs.data(), count, frame.planStart, frame.stepDelta, tickSteps.data());
+			if (tickSteps != steps) {
+				std::fprintf(stderr, "%s: frame %d got different steps than binInputSteps\n", path.name, f);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	const std::vector<NamedKernel> paths = kernels();
+	const std::vector<NamedTickKernel> tickPaths = tickKernels();
+	if (!check(paths, tickPaths)) return 1;
+	std::printf("%d random frames binned identically by every path, steps-only included\n\n", CHECK_FRAMES);
+	if (checkOnly(argc, argv)) return 0;
+
+	std::printf("%8s %10s", "inputs", "per-step");
+	for (const NamedKernel& path : paths) std::printf(" %10s", path.name);
+	std::printf(" %10s", tickPaths.back().name);
+	std::printf("   (ns/input, best of %d)\n", ROUNDS);
+
+	for (size_t count : { 1, 10, 100, 1000, 10000 }) {
+		// a 1 second frame at 240 TPS with everything inside it, the common case
+		std::mt19937_64 rng(count);
+		Frame frame;
+		frame.stepCount = 240;
+		frame.stepDelta = TICKS_PER_SECOND / frame.stepCount + 1;
+		frame.planStart = TICKS_PER_SECOND * 1000;
+		std::uniform_int_distribution<TimestampType> offset(0, TICKS_PER_SECOND - 1);
+		frame.inputs.resize(count);
+		for (InputEvent& input : frame.inputs) input = InputEvent{ frame.planStart + offset(rng), InputButton::Jump, true, true };
+		std::sort(frame.inputs.begin(), frame.inputs.end(), [](const InputEvent& a, const InputEvent& b) { return a.time < b.time; });
+
+		std::vector<uint32_t> steps(count);
+		std::vector<double> fractions(count);
+		const int repeats = static_cast<int>(std::max<size_t>(1, 200'000 / count));
+
+		auto time = [&](auto&& bin) {
+			int64_t best = INT64_MAX;
+			for (int round = 0; round < ROUNDS; round++) {
+				const int64_t start = nowNs();
+				for (int r = 0; r < repeats; r++) {
+					bin();
+					doNotOptimize(steps[count - 1]);
+					doNotOptimize(fractions[count - 1]);
+				}
+				best = std::min(best, nowNs() - start);
+			}
+			return static_cast<double>(best) / repeats / count;
+		};
+
+		std::printf("%8zu %10.2f", count, time([&]() { referenceBins(frame, steps.data(), fractions.data()); }));
+		for (const NamedKernel& path : paths) {
+			std::printf(" %10.2f", time([&]() {
+				path.kernel(frame.inputs.data(), count, frame.planStart, frame.stepDelta, steps.data(), fractions.data());
+			}));
+		}
+		std::printf(" %10.2f", time([&]() { tickPaths.back().kernel(frame.inputs.data(), count, frame.planStart, frame.stepDelta, steps.data()); }));
+		std::printf("\n");
+	}
+
+	return 0;
+}
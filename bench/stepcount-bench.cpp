@@ -0,0 +1,182 @@
+// step count strategies: checks each one against the original branching function bit for bit, then times both
+
+#include "bench.hpp"
+
+#include "core/scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+constexpr int FRAMES = 200'000;
+constexpr int ROUNDS = 30;
+
+// stands in for CCDirector::sharedDirector()->getAnimationInterval(), which crossed into cocos every frame
+__attribute__((noinline)) double directorAnimationInterval(const double* interval) {
+	return *interval;
+}
+
+// calculateStepCount as it was before the strategies, kept verbatim as the reference
+int referenceStepCount(StepCountState& state, float delta, float timewarp, bool forceVanilla) {
+	// Vanilla 2.2 formula
+	if (!state.physicsBypass || forceVanilla) {
+		return static_cast<int>(std::round(std::max(1.0, ((delta * 60.0) / std::min(1.0f, timewarp)) * 4.0)));
+	}
+
+	// Legacy 2.1 physics bypass
+	if (state.legacyBypass) {
+		return static_cast<int>(std::round(std::max(4.0, delta * 240.0) / std::min(1.0f, timewarp)));
+	}
+
+	// Modern 2.2 physics bypass with lag compensation
+	const double animationInterval = state.animationInterval;
+
+	// Exponential moving average with saturation protection
+	state.averageDelta = (EMA_ALPHA * delta) + ((1.0 - EMA_ALPHA) * state.averageDelta);
+	state.averageDelta = std::min(state.averageDelta, animationInterval * EMA_MAX_RATIO);
+
+	const bool laggingOneFrame = animationInterval < delta - (1.0 / 240.0);
+	const bool laggingSustained = state.averageDelta - animationInterval > LAG_THRESHOLD;
+
+	// No step variance when running smoothly
+	if (!laggingOneFrame && !laggingSustained) {
+		return static_cast<int>(std::round(std::ceil((animationInterval * 240.0) - STEP_EPSILON) / std::min(1.0f, timewarp)));
+	}
+	// Sustained low fps
+	else if (!laggingOneFrame) {
+		return static_cast<int>(std::round(std::ceil(state.averageDelta * 240.0) / std::min(1.0f, timewarp)));
+	}
+	// Single frame spike - catch up
+	else {
+		return static_cast<int>(std::round(std::ceil(delta * 240.0) / std::min(1.0f, timewarp)));
+	}
+}
+
+struct Frame {
+	float delta;
+	float timewarp;
+};
+
+// smooth frames with jitter, stutters, long hitches and timewarp changes, around a target refresh rate
+std::vector<Frame> buildFrames(double interval, uint32_t seed) {
+	std::mt19937 rng(seed);
+	std::normal_distribution<double> jitter(0.0, interval * 0.05);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	const float timewarps[] = { 1.0f, 1.0f, 1.0f, 0.5f, 0.25f, 2.0f };
+
+	std::vector<Frame> frames(FRAMES);
+	float timewarp = 1.0f;
+	for (Frame& frame : frames) {
+		double delta = interval + jitter(rng);
+		const double roll = uniform(rng);
+		if (roll < 0.002) delta = 0.05 + uniform(rng); // hitch up to a second
+		else if (roll < 0.02) delta *= 2.0 + uniform(rng) * 3.0; // dropped frames
+		if (uniform(rng) < 0.001) timewarp = timewarps[rng() % std::size(timewarps)];
+
+		frame.delta = static_cast<float>(std::max(delta, 0.0001));
+		frame.timewarp = timewarp;
+	}
+	return frames;
+}
+
+template <StepCountMode Mode>
+bool verify(const char* name, bool physicsBypass, bool legacyBypass) {
+	const double intervals[] = { 1.0 / 30, 1.0 / 60, 1.0 / 144, 1.0 / 240, 1.0 / 360, 1.0 / 540, 1.0 / 1000 };
+	uint64_t checked = 0;
+
+	for (double interval : intervals) {
+		const std::vector<Frame> frames = buildFrames(interval, static_cast<uint32_t>(interval * 1e6));
+
+		StepCountState reference;
+		reference.physicsBypass = physicsBypass;
+		reference.legacyBypass = legacyBypass;
+		reference.animationInterval = interval;
+		StepCountState strategy = reference;
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			const int expected = referenceStepCount(reference, frames[i].delta, frames[i].timewarp, false);
+			const int actual = StepCountStrategy<Mode>::calculate(strategy, frames[i].delta, frames[i].timewarp);
+
+			if (expected != actual || std::memcmp(&reference.averageDelta, &strategy.averageDelta, sizeof(double)) != 0) {
+				std::printf("%s: frame %zu at %.0f FPS differs: %d steps vs %d\n", name, i, 1.0 / interval, expected, actual);
+				return false;
+			}
+			checked++;
+		}
+
+		// outside of levels the mod forces the vanilla formula even with bypass on
+		for (size_t i = 0; i < 1000; i++) {
+			StepCountState copy = reference;
+			if (referenceStepCount(copy, frames[i].delta, frames[i].timewarp, true)
+				!= StepCountStrategy<StepCountMode::Vanilla>::calculate(copy, frames[i].delta, frames[i].timewarp)) {
+				std::printf("%s: forced vanilla differs on frame %zu\n", name, i);
+				return false;
+			}
+		}
+	}
+
+	std::printf("%-8s %llu frames identical\n", name, static_cast<unsigned long long>(checked));
+	return true;
+}
+
+// a global like in the mod, so the switch isn't folded away
+StepCountMode stepCountMode = StepCountMode::Vanilla;
+
+void time(const char* name, bool physicsBypass, bool legacyBypass) {
+	const double interval = 1.0 / 360;
+	const std::vector<Frame> frames = buildFrames(interval, 99);
+
+	auto pass = [&](auto&& calculate) {
+		StepCountState state;
+		state.physicsBypass = physicsBypass;
+		state.legacyBypass = legacyBypass;
+		state.animationInterval = interval;
+
+		const int64_t start = nowNs();
+		int total = 0;
+		for (const Frame& frame : frames) total += calculate(state, frame);
+		const int64_t elapsed = nowNs() - start;
+		doNotOptimize(total);
+		return elapsed;
+	};
+
+	// what the mod did per frame: read the director in 2.2 mode, then branch on the settings
+	auto reference = [&](StepCountState& state, const Frame& frame) {
+		if (state.physicsBypass && !state.legacyBypass) state.animationInterval = directorAnimationInterval(&interval);
+		return referenceStepCount(state, frame.delta, frame.timewarp, false);
+	};
+
+	// what it does now: the mode picked when the settings changed, switched on with the strategy inlined, and the interval cached
+	stepCountMode = selectStepCountMode(physicsBypass, legacyBypass);
+	auto strategy = [&](StepCountState& state, const Frame& frame) {
+		return calculateStepCount(stepCountMode, state, frame.delta, frame.timewarp);
+	};
+
+	// alternating the two, so a frequency change or a noisy neighbour hits both
+	int64_t referenceBest = INT64_MAX;
+	int64_t strategyBest = INT64_MAX;
+	for (int round = 0; round < ROUNDS; round++) {
+		referenceBest = std::min(referenceBest, pass(reference));
+		strategyBest = std::min(strategyBest, pass(strategy));
+	}
+
+	std::printf("%-8s %10.2f ns/frame branching %10.2f ns/frame strategy\n", name,
+		static_cast<double>(referenceBest) / frames.size(), static_cast<double>(strategyBest) / frames.size());
+}
+
+int main(int argc, char** argv) {
+	bool ok = true;
+	ok &= verify<StepCountMode::Vanilla>("vanilla", false, false);
+	ok &= verify<StepCountMode::Legacy>("2.1", true, true);
+	ok &= verify<StepCountMode::Modern>("2.2", true, false);
+	if (!ok) return 1;
+	if (checkOnly(argc, argv)) return 0;
+
+	time("vanilla", false, false);
+	time("2.1", true, true);
+	time("2.2", true, false);
+	return 0;
+}
@@ -40,11 +40,23 @@ void JNICALL JNI_setNextInputTimestamp(JNIEnv* env, jobject, jlong timestamp) {
 	lastTimestamp = timestamp / 1'000;
 }
 
-TimestampType getCurrentTimestamp() {
-	struct timespec now;
-	clock_gettime(CLOCK_MONOTONIC, &now);
-	// time as μs
-	return (static_cast<TimestampType>(now.tv_sec) * 1'000'000) + (now.tv_nsec / 1'000);
+class MonotonicClock : public Clock {
+public:
+	TimestampType now() const override {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		// time as μs
+		return (static_cast<TimestampType>(now.tv_sec) * 1'000'000) + (now.tv_nsec / 1'000);
+	}
+
+	TimestampType frequency() const override {
+		return 1'000'000;
+	}
+};
+
+const Clock& platformClock() {
+	static const MonotonicClock clock;
+	return clock;
 }
 
 #include <Geode/modify/CCTouchDispatcher.hpp>
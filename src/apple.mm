@@ -17,9 +17,21 @@
 
 #include "includes.hpp"
 
-TimestampType getCurrentTimestamp() {
-	// convert ns to μs
-	return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1'000;
+class UptimeClock : public Clock {
+public:
+	TimestampType now() const override {
+		// convert ns to μs
+		return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1'000;
+	}
+
+	TimestampType frequency() const override {
+		return 1'000'000;
+	}
+};
+
+const Clock& platformClock() {
+	static const UptimeClock clock;
+	return clock;
 }
 
 @interface EAGLView : GEODE_MACOS(NSOpenGLView) GEODE_IOS(UIView)
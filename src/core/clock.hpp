@@ -0,0 +1,72 @@
+#pragma once
+
+// where timestamps come from, so everything timing sensitive can also run against a simulated clock
+
+#include <chrono>
+#include <cstdint>
+
+using TimestampType = int64_t;
+
+class Clock {
+public:
+	virtual ~Clock() = default;
+
+	virtual TimestampType now() const = 0;
+
+	// ticks per second
+	virtual TimestampType frequency() const = 0;
+};
+
+/*
+std::chrono::steady_clock in nanoseconds, for the tools and anything that isn't given a platform clock.
+*/
+class SteadyClock : public Clock {
+public:
+	TimestampType now() const override {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	TimestampType frequency() const override {
+		return 1'000'000'000;
+	}
+};
+
+inline const Clock& steadyClock() {
+	static const SteadyClock clock;
+	return clock;
+}
+
+/*
+Only moves when it is told to, so benchmarks and replays see exactly the frame times they ask for.
+*/
+class VirtualClock : public Clock {
+public:
+	explicit VirtualClock(TimestampType frequency, TimestampType start = 0) : m_frequency(frequency), m_now(start) {}
+
+	TimestampType now() const override {
+		return m_now;
+	}
+
+	TimestampType frequency() const override {
+		return m_frequency;
+	}
+
+	void set(TimestampType time) {
+		m_now = time;
+	}
+
+	void advance(TimestampType ticks) {
+		m_now += ticks;
+	}
+
+	// returns the ticks actually advanced, rounded down to a whole tick
+	TimestampType advanceSeconds(double seconds) {
+		const TimestampType ticks = static_cast<TimestampType>(seconds * static_cast<double>(m_frequency));
+		m_now += ticks;
+		return ticks;
+	}
+
+private:
+	TimestampType m_frequency;
+	TimestampType m_now;
+};
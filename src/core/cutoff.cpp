@@ -0,0 +1,25 @@
+#include "cutoff.hpp"
+
+#include <algorithm>
+
+TimestampType AdaptiveCutoff::offset(TimestampType gap) {
+	gap = std::max<TimestampType>(gap, 0);
+	m_gaps.push(static_cast<double>(gap));
+
+	// sorting the window every frame isn't worth it, the distribution doesn't change that fast
+	if (++m_frames % ADAPTIVE_CUTOFF_REFRESH == 0) {
+		const TimestampType wanted = static_cast<TimestampType>(m_gaps.percentile(ADAPTIVE_CUTOFF_FRACTION)) + m_bound;
+
+		// changing the offset moves one frame boundary by the same amount, so it never moves by more than the bound at once
+		m_target = std::clamp(wanted, m_target - m_bound, m_target + m_bound);
+		m_target = std::max<TimestampType>(m_target, 0);
+	}
+
+	return std::min(m_target, gap);
+}
+
+void AdaptiveCutoff::reset() {
+	m_gaps.clear();
+	m_target = 0;
+	m_frames = 0;
+}
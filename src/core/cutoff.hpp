@@ -0,0 +1,57 @@
+#pragma once
+
+// adaptive input cutoff: how far past the start of the frame inputs can still be taken without making step placement inconsistent
+
+#include <cstddef>
+
+#include "scheduler.hpp"
+#include "predictor.hpp"
+
+constexpr size_t ADAPTIVE_CUTOFF_WINDOW = 120;    // frames of poll to build gaps remembered
+constexpr double ADAPTIVE_CUTOFF_FRACTION = 0.02; // frames with a gap shorter than this percentile can go over the bound
+constexpr int ADAPTIVE_CUTOFF_REFRESH = 30;       // frames between offset updates
+constexpr int64_t ADAPTIVE_CUTOFF_DEFAULT_BOUND_US = 250; // the "cutoff-error-bound" setting's default
+
+/*
+Early cutoff plans each frame up to when it started and late cutoff up to when it's built.
+Late takes more inputs, but the gap between the two moves around from frame to frame,
+and every frame boundary that moves shifts the inputs around it by as much.
+
+Adaptive cutoff plans up to frame start + offset instead. The offset is the gap that nearly every
+recent frame reached (ADAPTIVE_CUTOFF_FRACTION) plus the error bound, so on almost every frame the
+boundary sits exactly offset after the frame start and placement is as consistent as with early cutoff.
+When a frame is built sooner than that the cutoff is simply now, which moves that boundary by less than the bound.
+A bound of 0 never moves the offset, which is early cutoff.
+*/
+class AdaptiveCutoff {
+public:
+	void setErrorBound(TimestampType ticks) {
+		m_bound = ticks;
+	}
+
+	// called once per frame with the ticks from the frame start to now, returns how many of them to take inputs from
+	TimestampType offset(TimestampType gap);
+
+	TimestampType target() const {
+		return m_target;
+	}
+
+	void reset();
+
+private:
+	FrameWindow m_gaps{ ADAPTIVE_CUTOFF_WINDOW };
+	TimestampType m_bound = 0;
+	TimestampType m_target = 0;
+	int m_frames = 0;
+};
+
+/*
+Move currentFrameTime, stamped when the frame started, forward to the adaptive cutoff.
+Inputs past it stay in the lanes for the next frame, like with early cutoff.
+Returns the gap from the frame start to now.
+*/
+inline TimestampType applyAdaptiveCutoff(StepScheduler& s, AdaptiveCutoff& cutoff) {
+	const TimestampType gap = s.clock->now() - s.currentFrameTime;
+	s.currentFrameTime += cutoff.offset(gap);
+	return gap;
+}
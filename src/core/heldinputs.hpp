@@ -0,0 +1,40 @@
+#pragma once
+
+// which keys and buttons are currently down, shared by every input thread
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+One bit per 16-bit key code. press() and release() are atomic test-and-set / test-and-clear,
+so each edge is reported exactly once even if two threads race on the same key.
+*/
+class HeldInputs {
+public:
+	bool contains(uint16_t key) const {
+		return m_words[key / 64].load(std::memory_order_relaxed) & bit(key);
+	}
+
+	// returns false if the key was already held
+	bool press(uint16_t key) {
+		return !(m_words[key / 64].fetch_or(bit(key), std::memory_order_relaxed) & bit(key));
+	}
+
+	// returns false if the key wasn't held
+	bool release(uint16_t key) {
+		return m_words[key / 64].fetch_and(~bit(key), std::memory_order_relaxed) & bit(key);
+	}
+
+	void clear() {
+		for (auto& word : m_words) word.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr uint64_t bit(uint16_t key) {
+		return uint64_t(1) << (key % 64);
+	}
+
+	std::array<std::atomic<uint64_t>, 65536 / 64> m_words{};
+};
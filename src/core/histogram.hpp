@@ -0,0 +1,108 @@
+#pragma once
+
+// fixed-layout log-linear histogram, cheap enough to record into every frame
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+/*
+Values below 2^HISTOGRAM_SUB_BITS get a bucket each, every power of two above that is split into
+2^HISTOGRAM_SUB_BITS buckets, so a bucket is never wider than 1/32 of its value.
+The layout doesn't depend on anything else, so percentiles from different builds can be compared directly.
+
+One thread records, any thread can read: counts are relaxed atomics written with a plain load + store.
+*/
+constexpr int HISTOGRAM_SUB_BITS = 5;
+constexpr size_t HISTOGRAM_SUB_BUCKETS = size_t(1) << HISTOGRAM_SUB_BITS;
+constexpr size_t HISTOGRAM_BUCKETS = (64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+class Histogram {
+public:
+	static constexpr size_t bucketOf(uint64_t value) {
+		if (value < HISTOGRAM_SUB_BUCKETS) return static_cast<size_t>(value);
+
+		const int exponent = std::bit_width(value) - 1;
+		const size_t mantissa = static_cast<size_t>(value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+		return static_cast<size_t>(exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + mantissa;
+	}
+
+	static constexpr uint64_t bucketLowerBound(size_t bucket) {
+		if (bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+
+		const int exponent = static_cast<int>(bucket / HISTOGRAM_SUB_BUCKETS) + HISTOGRAM_SUB_BITS - 1;
+		const uint64_t mantissa = bucket % HISTOGRAM_SUB_BUCKETS;
+		return (HISTOGRAM_SUB_BUCKETS + mantissa) << (exponent - HISTOGRAM_SUB_BITS);
+	}
+
+	void record(uint64_t value) {
+		bump(m_counts[bucketOf(value)], 1);
+		bump(m_sum, value);
+		if (value > m_max.load(std::memory_order_relaxed)) m_max.store(value, std::memory_order_relaxed);
+	}
+
+	// summed when read, so recording touches one counter less
+	uint64_t count() const {
+		uint64_t total = 0;
+		for (auto& bucket : m_counts) total += bucket.load(std::memory_order_relaxed);
+		return total;
+	}
+
+	uint64_t max() const {
+		return m_max.load(std::memory_order_relaxed);
+	}
+
+	double mean() const {
+		const uint64_t n = count();
+		return n ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / n : 0.0;
+	}
+
+	// middle of the bucket holding the given fraction (0-1) of the values, capped at the real maximum
+	uint64_t percentile(double fraction) const {
+		const uint64_t n = count();
+		if (!n) return 0;
+
+		const uint64_t rank = static_cast<uint64_t>(fraction * (n - 1));
+		uint64_t seen = 0;
+		for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+			seen += m_counts[bucket].load(std::memory_order_relaxed);
+			if (seen > rank) {
+				const uint64_t low = bucketLowerBound(bucket);
+				const uint64_t high = bucket + 1 < HISTOGRAM_BUCKETS ? bucketLowerBound(bucket + 1) - 1 : UINT64_MAX;
+				const uint64_t middle = low + (high - low) / 2;
+				return middle < max() ? middle : max();
+			}
+		}
+		return max();
+	}
+
+	// only from the recording thread
+	void merge(const Histogram& other) {
+		for (size_t bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+			bump(m_counts[bucket], other.m_counts[bucket].load(std::memory_order_relaxed));
+		}
+		bump(m_sum, other.m_sum.load(std::memory_order_relaxed));
+		if (other.max() > max()) m_max.store(other.max(), std::memory_order_relaxed);
+	}
+
+	void clear() {
+		for (auto& bucket : m_counts) bucket.store(0, std::memory_order_relaxed);
+		m_sum.store(0, std::memory_order_relaxed);
+		m_max.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+		counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> m_counts{};
+	std::atomic<uint64_t> m_sum{ 0 };
+	std::atomic<uint64_t> m_max{ 0 };
+};
+
+static_assert(Histogram::bucketOf(UINT64_MAX) == HISTOGRAM_BUCKETS - 1);
+static_assert(Histogram::bucketLowerBound(Histogram::bucketOf(1000)) <= 1000);
+static_assert(Histogram::bucketLowerBound(Histogram::bucketOf(1000) + 1) > 1000);
@@ -0,0 +1,38 @@
+#pragma once
+
+// whether CBF should be scheduling inputs right now, kept up to date by hooks instead of being worked out every frame
+
+#include <atomic>
+#include <cstdint>
+
+enum GateReason : uint32_t {
+	GateDisabled = 1 << 0,   // "Disable CBF" is on
+	GateUnfocused = 1 << 1,  // the game window isn't in the foreground
+	GateNoLevel = 1 << 2,    // no PlayLayer in the running scene
+	GatePaused = 1 << 3,     // a PauseLayer is open
+	GateLevelEnded = 1 << 4, // the EndLevelLayer is showing
+};
+
+/*
+One bit per reason to keep CBF off, so the per-frame check is a single load.
+Every reason is set on the main thread: the layer hooks and the setting directly, and focus changes
+through the main thread's message loop, which is where SetWinEventHook delivers out of context events.
+*/
+class InputGate {
+public:
+	bool open() const {
+		return m_closed.load(std::memory_order_relaxed) == 0;
+	}
+
+	void set(GateReason reason, bool closed) {
+		if (closed) m_closed.fetch_or(reason, std::memory_order_relaxed);
+		else m_closed.fetch_and(~static_cast<uint32_t>(reason), std::memory_order_relaxed);
+	}
+
+	bool has(GateReason reason) const {
+		return m_closed.load(std::memory_order_relaxed) & reason;
+	}
+
+private:
+	std::atomic<uint32_t> m_closed{ GateNoLevel };
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+// per-producer input queues, merged by timestamp on the main thread
+
+#include <array>
+#include <cstdint>
+
+#include "scheduler.hpp"
+#include "spscring.hpp"
+
+// one lane per thread that produces inputs
+enum InputLane : size_t {
+	RawInputLane,   // raw input thread on Windows, queueButton on other platforms
+	XinputLane,     // xinput polling thread
+	LinuxLane,      // linuxCheckInputs, runs on the main thread
+	INPUT_LANE_COUNT
+};
+
+constexpr size_t INPUT_LANE_CAPACITY = 256;
+
+class InputLanes {
+public:
+	bool push(InputLane lane, const InputEvent& input) {
+		return m_lanes[lane].push(input);
+	}
+
+	/*
+	Pop the oldest event across all lanes, as long as it happened at or before cutoff.
+	Each lane is already in time order, so this is a k-way merge.
+	*/
+	bool popOldest(TimestampType cutoff, InputEvent& out) {
+		SpscRing<InputEvent, INPUT_LANE_CAPACITY>* oldest = nullptr;
+		const InputEvent* oldestInput = nullptr;
+
+		for (auto& lane : m_lanes) {
+			const InputEvent* input = lane.front();
+			if (input && input->time <= cutoff && (!oldestInput || input->time < oldestInput->time)) {
+				oldest = &lane;
+				oldestInput = input;
+			}
+		}
+
+		if (!oldest) return false;
+
+		out = *oldestInput;
+		oldest->pop();
+		return true;
+	}
+
+	void clear() {
+		for (auto& lane : m_lanes) lane.clear();
+	}
+
+	uint64_t dropped() const {
+		uint64_t total = 0;
+		for (auto& lane : m_lanes) total += lane.dropped();
+		return total;
+	}
+
+private:
+	std::array<SpscRing<InputEvent, INPUT_LANE_CAPACITY>, INPUT_LANE_COUNT> m_lanes;
+};
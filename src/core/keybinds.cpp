@@ -0,0 +1,33 @@
+#include "keybinds.hpp"
+
+#include <algorithm>
+
+KeyBindings::KeyBindings() {
+	m_tables.push_back(std::make_unique<KeyTable>());
+	m_current.store(m_tables.back().get(), std::memory_order_release);
+}
+
+bool KeyBindings::update(Binds binds) {
+	for (auto& hashes : binds) {
+		std::sort(hashes.begin(), hashes.end());
+		hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+	}
+	if (binds == m_binds) return false;
+
+	auto table = std::make_unique<KeyTable>();
+
+	// lowest priority first so earlier actions overwrite later ones
+	for (size_t action = KEY_ACTION_COUNT; action-- > 0;) {
+		const uint8_t button = static_cast<uint8_t>(action % 3) + static_cast<uint8_t>(InputButton::Jump);
+		const uint8_t entry = action < 3 ? button : button | KEY_PLAYER2;
+
+		for (size_t hash : binds[action]) {
+			if (hash < KEY_TABLE_SIZE) table->entries[hash] = entry;
+		}
+	}
+
+	m_current.store(table.get(), std::memory_order_release);
+	m_tables.push_back(std::move(table));
+	m_binds = std::move(binds);
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// key code -> bound action lookup, read without locking by every input thread
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "scheduler.hpp"
+
+// same order as GameAction: p1 jump, left, right, then p2
+constexpr size_t KEY_ACTION_COUNT = 6;
+
+// cocos2d key codes, controller buttons and vkeys all fit in 16 bits, binds with modifiers never match a bare key
+constexpr size_t KEY_TABLE_SIZE = 65536;
+
+/*
+One byte per key: 0 when unbound, otherwise the InputButton, plus KEY_PLAYER2 for p2 binds.
+When a key is bound to several actions, the first one in GameAction order wins.
+*/
+constexpr uint8_t KEY_PLAYER2 = 0x80;
+
+struct KeyTable {
+	std::array<uint8_t, KEY_TABLE_SIZE> entries{};
+};
+
+/*
+Published RCU-style: update() builds a new table and swaps the pointer, readers only do an acquire load.
+Replaced tables are kept until destruction since a reader could still be looking at one,
+binds only change when the player edits them so this stays at a few tables.
+*/
+class KeyBindings {
+public:
+	using Binds = std::array<std::vector<size_t>, KEY_ACTION_COUNT>;
+
+	KeyBindings();
+
+	// only call from one thread, returns false and keeps the current table if nothing changed
+	bool update(Binds binds);
+
+	bool lookup(size_t key, InputButton& button, bool& player1) const {
+		if (key >= KEY_TABLE_SIZE) return false;
+
+		const uint8_t entry = m_current.load(std::memory_order_acquire)->entries[key];
+		if (!entry) return false;
+
+		button = static_cast<InputButton>(entry & ~KEY_PLAYER2);
+		player1 = !(entry & KEY_PLAYER2);
+		return true;
+	}
+
+private:
+	std::atomic<const KeyTable*> m_current;
+	std::vector<std::unique_ptr<KeyTable>> m_tables; // every table ever published
+	Binds m_binds; // sorted, to tell if an update changes anything
+};
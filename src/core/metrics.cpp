@@ -0,0 +1,48 @@
+#include "metrics.hpp"
+
+void StepMetrics::merge(const StepMetrics& other) {
+	inputLatencyNs.merge(other.inputLatencyNs);
+	inputStep.merge(other.inputStep);
+	inputFactorPpm.merge(other.inputFactorPpm);
+	drainedInputs.merge(other.drainedInputs);
+	carriedInputs.merge(other.carriedInputs);
+	substeps.merge(other.substeps);
+	steps.merge(other.steps);
+}
+
+void StepMetrics::clear() {
+	inputLatencyNs.clear();
+	inputStep.clear();
+	inputFactorPpm.clear();
+	drainedInputs.clear();
+	carriedInputs.clear();
+	substeps.clear();
+	steps.clear();
+}
+
+static void writeLine(std::FILE* file, const char* name, const Histogram& histogram, double scale) {
+	std::fprintf(file, "  %-16s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name,
+		static_cast<unsigned long long>(histogram.count()),
+		histogram.mean() * scale,
+		histogram.percentile(0.5) * scale,
+		histogram.percentile(0.9) * scale,
+		histogram.percentile(0.99) * scale,
+		histogram.percentile(0.999) * scale,
+		histogram.max() * scale);
+}
+
+void writeMetricsSummary(std::FILE* file, const char* label, const StepMetrics& metrics) {
+	std::fprintf(file, "%s: %llu frames, %llu inputs\n", label,
+		static_cast<unsigned long long>(metrics.substeps.count()),
+		static_cast<unsigned long long>(metrics.inputLatencyNs.count()));
+	std::fprintf(file, "  %-16s %10s %10s %10s %10s %10s %10s %10s\n", "metric", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+
+	writeLine(file, "latency_us", metrics.inputLatencyNs, 0.001);
+	writeLine(file, "input_step", metrics.inputStep, 1.0);
+	writeLine(file, "input_factor", metrics.inputFactorPpm, 0.000001);
+	writeLine(file, "drained_inputs", metrics.drainedInputs, 1.0);
+	writeLine(file, "carried_inputs", metrics.carriedInputs, 1.0);
+	writeLine(file, "substeps", metrics.substeps, 1.0);
+	writeLine(file, "steps", metrics.steps, 1.0);
+	std::fflush(file);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// where inputs land in the step plan, recorded by the scheduler while metrics are enabled
+
+#include <cstdio>
+
+#include "histogram.hpp"
+
+struct StepMetrics {
+	Histogram inputLatencyNs;  // currentFrameTime - input.time, for every input placed in a plan
+	Histogram inputStep;       // index of the step each input lands in
+	Histogram inputFactorPpm;  // deltaFactor of each input substep, in millionths
+	Histogram drainedInputs;   // inputs taken from the lanes per frame
+	Histogram carriedInputs;   // inputs left over from the previous frame per frame
+	Histogram substeps;        // input substeps per frame, its count is the number of frames
+	Histogram steps;           // steps planned per frame
+
+	double nsPerTick = 1.0; // set from the timestamp frequency, so every build reports the same units
+
+	void merge(const StepMetrics& other);
+	void clear();
+};
+
+/*
+Append a summary block to file: one line per metric with count, mean, p50, p90, p99, p99.9 and max.
+Latency is printed in microseconds, factors as fractions, everything else as is.
+*/
+void writeMetricsSummary(std::FILE* file, const char* label, const StepMetrics& metrics);
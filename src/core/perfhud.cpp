@@ -0,0 +1,45 @@
+#include "perfhud.hpp"
+
+#include <cstdio>
+
+PerfSnapshot PerfWindow::take() {
+	PerfSnapshot snapshot;
+	snapshot.frames = m_buildNs.count();
+	snapshot.stepsPerFrame = metrics.steps.mean();
+	snapshot.substepsPerFrame = metrics.substeps.mean();
+	snapshot.inputsPerFrame = metrics.drainedInputs.mean();
+	snapshot.latencyP50Us = metrics.inputLatencyNs.percentile(0.5) * 0.001;
+	snapshot.latencyP99Us = metrics.inputLatencyNs.percentile(0.99) * 0.001;
+	snapshot.buildP50Us = m_buildNs.percentile(0.5) * 0.001;
+	snapshot.buildP99Us = m_buildNs.percentile(0.99) * 0.001;
+	snapshot.deltaP50Ms = m_deltaUs.percentile(0.5) * 0.001;
+	snapshot.deltaP99Ms = m_deltaUs.percentile(0.99) * 0.001;
+	snapshot.predictedDeltaMs = m_predictedDelta * 1e3;
+
+	clear();
+	return snapshot;
+}
+
+void PerfWindow::clear() {
+	metrics.clear();
+	m_buildNs.clear();
+	m_deltaUs.clear();
+}
+
+std::string formatPerfSnapshot(const PerfSnapshot& snapshot, bool showPredicted) {
+	char text[384];
+	const int length = std::snprintf(text, sizeof(text),
+		"steps %.1f  substeps %.2f  inputs %.2f\n"
+		"latency p50/p99 %.0f / %.0f us\n"
+		"build p50/p99 %.1f / %.1f us\n"
+		"delta p50/p99 %.2f / %.2f ms",
+		snapshot.stepsPerFrame, snapshot.substepsPerFrame, snapshot.inputsPerFrame,
+		snapshot.latencyP50Us, snapshot.latencyP99Us,
+		snapshot.buildP50Us, snapshot.buildP99Us,
+		snapshot.deltaP50Ms, snapshot.deltaP99Ms);
+
+	if (showPredicted && length > 0 && static_cast<size_t>(length) < sizeof(text)) {
+		std::snprintf(text + length, sizeof(text) - length, "  avg %.2f ms", snapshot.predictedDeltaMs);
+	}
+	return text;
+}
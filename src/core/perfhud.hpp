@@ -0,0 +1,54 @@
+#pragma once
+
+// numbers for the live performance HUD, gathered per frame and summarized a few times a second
+
+#include <cstdint>
+#include <string>
+
+#include "histogram.hpp"
+#include "metrics.hpp"
+
+/*
+One refresh interval of the HUD, reduced to what it shows.
+Per-frame values are means, latencies and durations are p50/p99.
+*/
+struct PerfSnapshot {
+	uint64_t frames = 0;
+	double stepsPerFrame = 0.0;
+	double substepsPerFrame = 0.0;
+	double inputsPerFrame = 0.0;
+	double latencyP50Us = 0.0;
+	double latencyP99Us = 0.0;
+	double buildP50Us = 0.0;
+	double buildP99Us = 0.0;
+	double deltaP50Ms = 0.0;
+	double deltaP99Ms = 0.0;
+	double predictedDeltaMs = 0.0; // the 2.2 bypass' averageDelta or predictor output at the end of the interval
+};
+
+/*
+While the HUD is shown the scheduler records into metrics, and the frame hook adds what only it knows.
+take() summarizes and clears everything, so every snapshot covers exactly one refresh interval
+and nothing but a few histogram bumps happens per frame.
+*/
+class PerfWindow {
+public:
+	StepMetrics metrics;
+
+	void recordFrame(uint64_t buildNs, double delta, double predictedDelta) {
+		m_buildNs.record(buildNs);
+		m_deltaUs.record(static_cast<uint64_t>(delta > 0.0 ? delta * 1e6 : 0.0));
+		m_predictedDelta = predictedDelta;
+	}
+
+	PerfSnapshot take();
+	void clear();
+
+private:
+	Histogram m_buildNs;
+	Histogram m_deltaUs;
+	double m_predictedDelta = 0.0;
+};
+
+// a few short lines for a CCLabelBMFont, the predicted delta only when showPredicted (the 2.2 bypass is on)
+std::string formatPerfSnapshot(const PerfSnapshot& snapshot, bool showPredicted);
@@ -0,0 +1,42 @@
+#include "predictor.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+FramePrediction EmaPredictor::update(double delta, double animationInterval) {
+	m_average = (EMA_ALPHA * delta) + ((1.0 - EMA_ALPHA) * m_average);
+	m_average = std::min(m_average, animationInterval * EMA_MAX_RATIO);
+	return FramePrediction{ m_average, m_average - animationInterval > LAG_THRESHOLD };
+}
+
+void FrameWindow::push(double delta) {
+	m_values[m_next] = delta;
+	m_next = (m_next + 1) % m_size;
+	m_count = std::min(m_count + 1, m_size);
+}
+
+double FrameWindow::percentile(double fraction) const {
+	if (!m_count) return 0.0;
+
+	std::array<double, PREDICTOR_MAX_WINDOW> sorted;
+	std::copy_n(m_values.begin(), m_count, sorted.begin());
+	const size_t rank = static_cast<size_t>(fraction * (m_count - 1) + 0.5);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + m_count);
+	return sorted[rank];
+}
+
+FramePrediction MedianPredictor::update(double delta, double animationInterval) {
+	m_window.push(std::min(delta, animationInterval * EMA_MAX_RATIO));
+	const double median = m_window.percentile(0.5);
+	return FramePrediction{ median, median - animationInterval > LAG_THRESHOLD };
+}
+
+FramePrediction PercentilePredictor::update(double delta, double animationInterval) {
+	m_window.push(std::min(delta, animationInterval * EMA_MAX_RATIO));
+	const double predicted = m_window.percentile(m_fraction);
+
+	if (m_lagging) m_lagging = predicted - animationInterval > m_exitMargin;
+	else m_lagging = predicted - animationInterval > m_enterMargin;
+
+	return FramePrediction{ predicted, m_lagging };
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// frame time predictors for the 2.2 physics bypass
+
+#include <array>
+#include <cstddef>
+
+/*
+What the 2.2 bypass needs to know about the recent frames: how long frames are expected to take,
+and whether that's slow enough to count as sustained lag instead of a single spike.
+*/
+struct FramePrediction {
+	double delta;
+	bool sustainedLag;
+};
+
+class FramePredictor {
+public:
+	virtual ~FramePredictor() = default;
+
+	virtual const char* name() const = 0;
+
+	// called once per frame with the real frame time
+	virtual FramePrediction update(double delta, double animationInterval) = 0;
+
+	virtual void reset() = 0;
+};
+
+// the original averageDelta: exponential moving average, capped at EMA_MAX_RATIO intervals
+class EmaPredictor final : public FramePredictor {
+public:
+	const char* name() const override { return "ema"; }
+	FramePrediction update(double delta, double animationInterval) override;
+	void reset() override { m_average = 0.0; }
+
+private:
+	double m_average = 0.0;
+};
+
+constexpr size_t PREDICTOR_MAX_WINDOW = 128;
+
+// last frame times, oldest overwritten first
+class FrameWindow {
+public:
+	explicit FrameWindow(size_t size) : m_size(size < PREDICTOR_MAX_WINDOW ? size : PREDICTOR_MAX_WINDOW) {}
+
+	void push(double delta);
+	void clear() { m_count = 0; m_next = 0; }
+
+	// value below which the given fraction (0-1) of the window falls
+	double percentile(double fraction) const;
+
+private:
+	std::array<double, PREDICTOR_MAX_WINDOW> m_values{};
+	size_t m_size;
+	size_t m_count = 0;
+	size_t m_next = 0;
+};
+
+// median of the last frames, ignores single spikes entirely
+class MedianPredictor final : public FramePredictor {
+public:
+	explicit MedianPredictor(size_t window = 15) : m_window(window) {}
+
+	const char* name() const override { return "median"; }
+	FramePrediction update(double delta, double animationInterval) override;
+	void reset() override { m_window.clear(); }
+
+private:
+	FrameWindow m_window;
+};
+
+/*
+High percentile of the last frames with hysteresis: lag starts once the percentile is enterMargin over the
+interval and only ends once it's back under exitMargin, so a refresh rate that wobbles around the threshold
+doesn't flip the step count every frame.
+*/
+class PercentilePredictor final : public FramePredictor {
+public:
+	explicit PercentilePredictor(size_t window = 60, double fraction = 0.9, double enterMargin = 0.001, double exitMargin = 0.0002)
+		: m_window(window), m_fraction(fraction), m_enterMargin(enterMargin), m_exitMargin(exitMargin) {}
+
+	const char* name() const override { return "percentile"; }
+	FramePrediction update(double delta, double animationInterval) override;
+	void reset() override { m_window.clear(); m_lagging = false; }
+
+private:
+	FrameWindow m_window;
+	double m_fraction;
+	double m_enterMargin;
+	double m_exitMargin;
+	bool m_lagging = false;
+};
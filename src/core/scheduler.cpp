@@ -0,0 +1,234 @@
+#include "scheduler.hpp"
+#include "inputlanes.hpp"
+#include "trace.hpp"
+#include "metrics.hpp"
+#include "predictor.hpp"
+#include "stepbins.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// the shared body of both drainInputs, pop(cutoff, out) hands out the next input up to cutoff
+template <typename Pop>
+static void drainFrom(StepScheduler& s, bool lateCutoff, size_t limit, Pop&& pop) {
+	// inputs of the last frame that were never planned because not all of its steps ran, a full plan would have dropped them too
+	if (s.plannedSteps < s.planSteps) {
+		const TimestampType planEnd = s.planStepDelta * s.planSteps;
+		while (s.inputHead < s.inputCount && s.inputs[s.inputHead].time - s.planStart < planEnd) s.inputHead++;
+		s.planSteps = s.plannedSteps;
+	}
+
+	TimestampType cutoff = s.currentFrameTime;
+	if (lateCutoff) {
+		cutoff = std::numeric_limits<TimestampType>::max();
+		s.inputHead = 0;
+		s.inputCount = 0;
+	}
+	else if (s.inputHead != 0) {
+		// carry inputs that didn't fit into the last frame over to the front
+		std::copy(s.inputs.begin() + s.inputHead, s.inputs.begin() + s.inputCount, s.inputs.begin());
+		s.inputCount -= s.inputHead;
+		s.inputHead = 0;
+	}
+
+	const size_t carried = s.inputCount;
+	limit = std::min(limit, s.catchingUp ? CATCH_UP_INPUTS : MAX_FRAME_INPUTS);
+
+	const bool recording = s.recorder && s.recorder->active();
+	while (s.inputCount < limit && pop(cutoff, s.inputs[s.inputCount])) {
+		if (recording) s.recorder->recordInput(s.inputs[s.inputCount]);
+		s.inputCount++;
+	}
+	s.catchingUp = limit == CATCH_UP_INPUTS && s.inputCount == limit;
+
+	if (s.metrics) {
+		s.metrics->carriedInputs.record(carried);
+		s.metrics->drainedInputs.record(s.inputCount - carried);
+	}
+
+	// the Linux helper forwards several devices through one lane, so a lane can be slightly out of order
+	for (size_t i = std::max<size_t>(carried, 1); i < s.inputCount; i++) {
+		for (size_t j = i; j > 0 && s.inputs[j].time < s.inputs[j - 1].time; j--) {
+			std::swap(s.inputs[j], s.inputs[j - 1]);
+		}
+	}
+}
+
+void drainInputs(StepScheduler& s, InputLanes& lanes, bool lateCutoff, size_t limit) {
+	drainFrom(s, lateCutoff, limit, [&](TimestampType cutoff, InputEvent& out) { return lanes.popOldest(cutoff, out); });
+}
+
+size_t drainInputs(StepScheduler& s, const InputEvent* inputs, size_t count, bool lateCutoff, size_t limit) {
+	size_t taken = 0;
+	drainFrom(s, lateCutoff, limit, [&](TimestampType cutoff, InputEvent& out) {
+		if (taken == count || inputs[taken].time > cutoff) return false;
+		out = inputs[taken++];
+		return true;
+	});
+	return taken;
+}
+
+// shared start of buildStepQueue and buildTickBuckets, returns false on the first frame, which has nothing to plan
+static bool startFrame(StepScheduler& s, int stepCount) {
+	s.nextInput = NO_INPUT;
+	s.nextInputCount = 0;
+	s.stepQueue.clear();
+	s.plannedSteps = 0;
+	s.planSteps = 0;
+
+	s.skipUpdate = false;
+	if (s.firstFrame) {
+		s.skipUpdate = true;
+		s.firstFrame = false;
+		s.lastFrameTime = s.currentFrameTime;
+		s.inputHead = 0;
+		s.inputCount = 0;
+		return false;
+	}
+
+	TimestampType deltaTime = s.currentFrameTime - s.lastFrameTime;
+
+	s.planStart = s.lastFrameTime;
+	s.planSteps = stepCount;
+	s.plannedSteps = 0;
+	s.plannedSubsteps = 0;
+	if (s.metrics) s.metrics->steps.record(static_cast<uint64_t>(stepCount));
+
+	// only inputs need the step length, and on a frame without any the division is most of the work
+	if (s.inputHead < s.inputCount) s.planStepDelta = (deltaTime / stepCount) + 1;
+
+	s.lastFrameTime = s.currentFrameTime;
+	return true;
+}
+
+/*
+Original implementation by theyareonit, with critical physics fix applied.
+*/
+void buildStepQueue(StepScheduler& s, int stepCount) {
+	s.tickPlan = false;
+	if (!startFrame(s, stepCount)) return;
+
+	// most frames have no inputs, which makes the whole plan a single run of plain steps
+	if (s.inputHead == s.inputCount) {
+		s.stepQueue.push_run(EMPTY_STEP, static_cast<uint32_t>(stepCount));
+		s.plannedSteps = stepCount;
+		if (s.metrics) s.metrics->substeps.record(0);
+		return;
+	}
+
+	binInputSteps(s.inputs.data() + s.inputHead, s.inputCount - s.inputHead, s.planStart, s.planStepDelta,
+		s.inputSteps.data() + s.inputHead, s.inputFractions.data() + s.inputHead);
+	planNextSteps(s);
+}
+
+void buildTickBuckets(StepScheduler& s, int stepCount) {
+	s.tickPlan = true;
+	if (!startFrame(s, stepCount)) return;
+
+	// ticks only need the step, not how far into it
+	if (s.inputHead < s.inputCount) {
+		binInputTicks(s.inputs.data() + s.inputHead, s.inputCount - s.inputHead, s.planStart, s.planStepDelta, s.inputSteps.data() + s.inputHead);
+	}
+	if (!s.metrics) return;
+
+	// the inputs are sorted, so the ones past the last tick are all at the end and stay for the next frame
+	StepMetrics* metrics = s.metrics;
+	for (size_t i = s.inputHead; i < s.inputCount && s.inputSteps[i] < static_cast<uint32_t>(stepCount); i++) {
+		const TimestampType latency = std::max<TimestampType>(0, s.currentFrameTime - s.inputs[i].time);
+		metrics->inputLatencyNs.record(static_cast<uint64_t>(latency * metrics->nsPerTick));
+		metrics->inputStep.record(static_cast<uint64_t>(s.inputSteps[i]));
+	}
+	metrics->substeps.record(0);
+}
+
+bool planNextSteps(StepScheduler& s) {
+	if (s.plannedSteps >= s.planSteps || s.tickPlan) return false;
+
+	const int stepCount = s.planSteps;
+	int i = s.plannedSteps;
+
+	// every step before the one the next input lands in is a plain full step, so a frame without inputs is a single run
+	int inputStep = stepCount;
+	if (s.inputHead < s.inputCount) {
+		inputStep = static_cast<int>(std::clamp<int64_t>(s.inputSteps[s.inputHead], i, stepCount));
+	}
+	if (inputStep > i) {
+		s.stepQueue.push_run(EMPTY_STEP, static_cast<uint32_t>(inputStep - i));
+		i = inputStep;
+	}
+
+	StepMetrics* metrics = s.metrics;
+
+	if (i < stepCount) {
+		double elapsedTime = 0.0;
+		TimestampType substepTime = 0;
+		bool substepOpen = false;
+
+		while (s.inputHead < s.inputCount) {
+			const InputEvent& front = s.inputs[s.inputHead];
+
+			if (s.inputSteps[s.inputHead] <= static_cast<uint32_t>(i)) {
+				// close enough to the last split point to be applied there, without another substep
+				if (substepOpen && front.time - substepTime < s.coalesceTicks && s.stepQueue.back().inputCount < MAX_COALESCED_INPUTS) {
+					s.stepQueue.back().inputCount++;
+
+					if (metrics) {
+						const TimestampType latency = std::max<TimestampType>(0, s.currentFrameTime - front.time);
+						metrics->inputLatencyNs.record(static_cast<uint64_t>(latency * metrics->nsPerTick));
+						metrics->inputStep.record(static_cast<uint64_t>(i));
+						metrics->inputFactorPpm.record(0);
+					}
+
+					s.inputHead++;
+					continue;
+				}
+
+				double inputTime = s.inputFractions[s.inputHead];
+				const float deltaFactor = static_cast<float>(std::clamp(inputTime - elapsedTime, SMALLEST_FLOAT, 1.0));
+				s.stepQueue.push_back(Step{
+					static_cast<uint16_t>(s.inputHead),
+					1,
+					false,
+					deltaFactor
+				});
+				substepTime = front.time;
+				substepOpen = true;
+
+				if (metrics) {
+					// late cutoff can take inputs from after currentFrameTime
+					const TimestampType latency = std::max<TimestampType>(0, s.currentFrameTime - front.time);
+					metrics->inputLatencyNs.record(static_cast<uint64_t>(latency * metrics->nsPerTick));
+					metrics->inputStep.record(static_cast<uint64_t>(i));
+					metrics->inputFactorPpm.record(static_cast<uint64_t>(deltaFactor * 1e6f));
+				}
+
+				s.plannedSubsteps++;
+				s.inputHead++;
+				elapsedTime = inputTime;
+			}
+			else break;
+		}
+
+		s.stepQueue.push_back(Step{ NO_INPUT, 0, true, static_cast<float>(std::max(SMALLEST_FLOAT, 1.0 - elapsedTime)) });
+		i++;
+	}
+
+	s.plannedSteps = i;
+	if (metrics && i == stepCount) metrics->substeps.record(s.plannedSubsteps);
+
+	return true;
+}
+
+void resetStepScheduler(StepScheduler& s) {
+	s.planSteps = s.plannedSteps;
+	s.catchingUp = false;
+	s.firstFrame = true;
+	s.skipUpdate = true;
+	s.inputHead = 0;
+	s.inputCount = 0;
+}
+
+int calculateStepCount(StepCountState& state, float delta, float timewarp, bool forceVanilla) {
+	if (forceVanilla) return StepCountStrategy<StepCountMode::Vanilla>::calculate(state, delta, timewarp);
+	return calculateStepCount(selectStepCountMode(state.physicsBypass, state.legacyBypass, state.fixedBypass), state, delta, timewarp);
+}
@@ -0,0 +1,391 @@
+#pragma once
+
+// Geode-free step scheduler, shared by the mod and the Linux benchmarks
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "clock.hpp"
+#include "predictor.hpp"
+
+// same values as PlayerButton in the GD bindings
+enum class InputButton : uint8_t {
+	Jump = 1,
+	Left = 2,
+	Right = 3
+};
+
+struct InputEvent {
+	TimestampType time;
+	InputButton inputType;
+	bool inputState;
+	bool isPlayer1;
+};
+
+constexpr uint16_t NO_INPUT = UINT16_MAX;
+
+// packed step record, inputIndex points into StepScheduler::inputs, inputCount inputs are applied together
+struct Step {
+	uint16_t inputIndex;
+	uint8_t inputCount;
+	bool endStep;
+	float deltaFactor;
+};
+
+static_assert(sizeof(Step) == 8);
+
+// most inputs one coalesced substep can apply
+constexpr uint8_t MAX_COALESCED_INPUTS = UINT8_MAX;
+
+constexpr double SMALLEST_FLOAT = std::numeric_limits<float>::min();
+
+constexpr InputEvent EMPTY_INPUT = InputEvent{
+	.time = 0,
+	.inputType = InputButton::Jump,
+	.inputState = false,
+	.isPlayer1 = false,
+};
+constexpr Step EMPTY_STEP = Step{
+	.inputIndex = NO_INPUT,
+	.inputCount = 0,
+	.endStep = true,
+	.deltaFactor = 1.0f,
+};
+
+// most inputs a single frame can hold, the rest stay in their lanes until the next frame
+constexpr size_t MAX_FRAME_INPUTS = 1024;
+
+// frames longer than this are hitches, measured in time rather than steps so a low framerate on a high tick rate isn't one
+constexpr double CATCH_UP_SECONDS = 0.1;
+
+// most inputs a hitch frame takes, the backlog from the freeze is spread over the frames after it
+constexpr size_t CATCH_UP_INPUTS = 64;
+
+// a step that is repeated count times in a row
+struct StepRun {
+	Step step;
+	uint32_t count;
+};
+
+// every input adds at most one run for its substep, one for the end of its step and one for the plain steps before it
+constexpr size_t PLAN_CAPACITY = 3 * MAX_FRAME_INPUTS + 1;
+
+/*
+Run-length step plan, e.g. "20 plain steps, input at 0.4, end step at 0.6, 19 plain steps".
+Steps without inputs (EMPTY_STEP) cost one run no matter how many there are, so the plan never grows past PLAN_CAPACITY.
+The runs live in a fixed array and are reset by index, so a frame never allocates,
+and a frame without inputs is a single run that costs a couple of stores to plan.
+*/
+class StepPlan {
+public:
+	bool empty() const {
+		return m_head == m_size;
+	}
+
+	const Step& front() const {
+		return m_runs[m_head].step;
+	}
+
+	void pop_front() {
+		if (--m_runs[m_head].count == 0) m_head++;
+	}
+
+	void push_back(const Step& step) {
+		m_runs[m_size++] = StepRun{ step, 1 };
+	}
+
+	void push_run(const Step& step, uint32_t count) {
+		if (count) m_runs[m_size++] = StepRun{ step, count };
+	}
+
+	Step& back() {
+		return m_runs[m_size - 1].step;
+	}
+
+	void clear() {
+		m_head = 0;
+		m_size = 0;
+	}
+
+private:
+	// the indices go first, right after the array they'd sit exactly 36KB from the first run and alias it in the store buffer
+	uint32_t m_head = 0;
+	uint32_t m_size = 0;
+	std::array<StepRun, PLAN_CAPACITY> m_runs;
+};
+
+// 2.2 physics bypass tuning
+constexpr double EMA_ALPHA = 0.05;       // weight of the newest frame in averageDelta
+constexpr double EMA_MAX_RATIO = 10.0;   // averageDelta can't exceed this many animation intervals
+constexpr double LAG_THRESHOLD = 0.0005; // how far averageDelta can drift before we consider it sustained lag
+constexpr double STEP_EPSILON = 0.0001;  // keeps e.g. 1/60 * 240 from rounding up to 5 steps
+
+// fixed tick rate bypass
+constexpr int FIXED_TPS_DEFAULT = 1000;
+constexpr double FIXED_MAX_DEBT = 1.0; // ticks a run of forced 1-step frames can run ahead of the tick rate
+
+class TraceRecorder;
+struct StepMetrics;
+
+struct StepScheduler {
+	// inputs drained for this frame, the ones before inputHead are already in stepQueue
+	std::array<InputEvent, MAX_FRAME_INPUTS> inputs;
+	size_t inputHead = 0;
+	size_t inputCount = 0;
+
+	// the step each input lands in and how far into it, binned for the whole frame by buildStepQueue (buildTickBuckets only bins the steps)
+	std::array<uint32_t, MAX_FRAME_INPUTS> inputSteps;
+	std::array<double, MAX_FRAME_INPUTS> inputFractions;
+
+	StepPlan stepQueue;
+
+	// the plan is built lazily, stepQueue only holds the steps up to and including the next one with inputs
+	TimestampType planStart = 0;
+	TimestampType planStepDelta = 0;
+	int plannedSteps = 0;
+	int planSteps = 0;
+	uint64_t plannedSubsteps = 0;
+	bool tickPlan = false; // built by buildTickBuckets, which leaves inputFractions stale, so planNextSteps won't touch it
+
+	// set while a hitch frame's backlog is still being worked off, the frames after it keep to the catch-up budget
+	bool catchingUp = false;
+
+	uint16_t nextInput = NO_INPUT;
+	uint8_t nextInputCount = 0;
+
+	// inputs less than this many ticks after the first input of a substep share its split point, 0 disables it
+	TimestampType coalesceTicks = 0;
+
+	// frame times, the input cutoff and latency metrics all come from this clock
+	const Clock* clock = &steadyClock();
+
+	TimestampType lastFrameTime = 0;
+	TimestampType currentFrameTime = 0;
+
+	bool firstFrame = true;
+	bool skipUpdate = true;
+
+	// gets every drained input while it's recording
+	TraceRecorder* recorder = nullptr;
+
+	// latency and plan shape histograms, nothing is recorded while this is null
+	StepMetrics* metrics = nullptr;
+};
+
+struct StepCountState {
+	bool physicsBypass = false;
+	bool legacyBypass = false;
+	bool fixedBypass = false;
+	double animationInterval = 1.0 / 60.0;
+	double averageDelta = 0.0;
+	double predictedDelta = 0.0; // what the 2.2 bypass last expected a frame to take, averageDelta or the predictor's
+
+	// replaces the averageDelta EMA in the 2.2 bypass when set
+	FramePredictor* predictor = nullptr;
+
+	int fixedTps = FIXED_TPS_DEFAULT;
+	double tickAccumulator = 0.0; // part of a tick the fixed bypass carries into the next frame
+};
+
+class InputLanes;
+
+/*
+Stamp the frame with the scheduler's clock. Called when the frame starts,
+and again right before it is built with late cutoff.
+*/
+inline void markFrameTime(StepScheduler& s) {
+	s.currentFrameTime = s.clock->now();
+}
+
+// the drain limit for the frame being built, once it's stamped, CATCH_UP_INPUTS if it's a hitch
+inline size_t frameInputLimit(const StepScheduler& s) {
+	if (s.firstFrame) return MAX_FRAME_INPUTS;
+	const TimestampType hitchTicks = static_cast<TimestampType>(CATCH_UP_SECONDS * static_cast<double>(s.clock->frequency()));
+	return s.currentFrameTime - s.lastFrameTime > hitchTicks ? CATCH_UP_INPUTS : MAX_FRAME_INPUTS;
+}
+
+/*
+Merge inputs from the producer lanes into the scheduler, oldest first, up to limit inputs in total.
+With late cutoff everything is taken, otherwise only inputs up to currentFrameTime.
+*/
+void drainInputs(StepScheduler& s, InputLanes& lanes, bool lateCutoff, size_t limit = MAX_FRAME_INPUTS);
+
+// the same from inputs that are already in order, e.g. a trace being replayed, returns how many were taken from the front
+size_t drainInputs(StepScheduler& s, const InputEvent* inputs, size_t count, bool lateCutoff, size_t limit = MAX_FRAME_INPUTS);
+
+/*
+Start the plan for this frame based on when the drained inputs occurred.
+Only the steps up to the first input are planned here, the rest as they are popped,
+so a hitch frame with hundreds of steps costs the same up front as any other frame.
+*/
+void buildStepQueue(StepScheduler& s, int stepCount);
+
+/*
+Plan the next plain run and step with inputs, returns false once the whole frame is planned
+or if the frame was built by buildTickBuckets.
+*/
+bool planNextSteps(StepScheduler& s);
+
+inline bool hasNextStep(StepScheduler& s) {
+	return !s.stepQueue.empty() || (s.plannedSteps < s.planSteps && planNextSteps(s));
+}
+
+/*
+Forget the current frame, e.g. when the level is paused or the mod is disabled.
+*/
+void resetStepScheduler(StepScheduler& s);
+
+enum class StepCountMode {
+	Vanilla,  // 2.2 formula, also used outside of levels with physics bypass on
+	Legacy,   // 2.1 physics bypass
+	Modern,   // 2.2 physics bypass with lag compensation
+	Fixed     // physics bypass at a fixed tick rate
+};
+
+/*
+One specialization per formula. They're defined here so the call site inlines them:
+the mod keeps the mode the settings picked and calls calculateStepCount(mode, ...) once per frame,
+which is a single switch on one value instead of a branch per setting, and never an indirect call.
+*/
+template <StepCountMode Mode>
+struct StepCountStrategy {
+	static int calculate(StepCountState& state, float delta, float timewarp);
+};
+
+// Vanilla 2.2 formula
+template <>
+inline int StepCountStrategy<StepCountMode::Vanilla>::calculate(StepCountState&, float delta, float timewarp) {
+	return static_cast<int>(std::round(std::max(1.0, ((delta * 60.0) / std::min(1.0f, timewarp)) * 4.0)));
+}
+
+// Legacy 2.1 physics bypass
+template <>
+inline int StepCountStrategy<StepCountMode::Legacy>::calculate(StepCountState&, float delta, float timewarp) {
+	return static_cast<int>(std::round(std::max(4.0, delta * 240.0) / std::min(1.0f, timewarp)));
+}
+
+// Modern 2.2 physics bypass with lag compensation
+template <>
+inline int StepCountStrategy<StepCountMode::Modern>::calculate(StepCountState& state, float delta, float timewarp) {
+	const double animationInterval = state.animationInterval;
+
+	FramePrediction prediction;
+	if (state.predictor) {
+		prediction = state.predictor->update(delta, animationInterval);
+	}
+	else {
+		// Exponential moving average with saturation protection
+		state.averageDelta = (EMA_ALPHA * delta) + ((1.0 - EMA_ALPHA) * state.averageDelta);
+		state.averageDelta = std::min(state.averageDelta, animationInterval * EMA_MAX_RATIO);
+		prediction = FramePrediction{ state.averageDelta, state.averageDelta - animationInterval > LAG_THRESHOLD };
+	}
+	state.predictedDelta = prediction.delta;
+
+	const bool laggingOneFrame = animationInterval < delta - (1.0 / 240.0);
+	const bool laggingSustained = prediction.sustainedLag;
+
+	// No step variance when running smoothly
+	if (!laggingOneFrame && !laggingSustained) {
+		return static_cast<int>(std::round(std::ceil((animationInterval * 240.0) - STEP_EPSILON) / std::min(1.0f, timewarp)));
+	}
+	// Sustained low fps
+	else if (!laggingOneFrame) {
+		return static_cast<int>(std::round(std::ceil(prediction.delta * 240.0) / std::min(1.0f, timewarp)));
+	}
+	// Single frame spike - catch up
+	else {
+		return static_cast<int>(std::round(std::ceil(delta * 240.0) / std::min(1.0f, timewarp)));
+	}
+}
+
+/*
+Fixed tick rate physics bypass: every frame gets the ticks its delta covers at fixedTps, rounded,
+and what rounding added or dropped is carried into the next one. Over any stretch of frames the tick count
+matches the real time that passed to within half a tick, and timestamp noise that a later frame cancels out
+doesn't change the step count at all.
+Frames shorter than a tick still get one step, which is paid back from later frames,
+but never more than FIXED_MAX_DEBT ticks of it so running above fixedTps doesn't build up a debt.
+*/
+template <>
+inline int StepCountStrategy<StepCountMode::Fixed>::calculate(StepCountState& state, float delta, float timewarp) {
+	const double ticks = state.tickAccumulator + (delta * state.fixedTps) / std::min(1.0f, timewarp);
+	const int steps = static_cast<int>(std::max(1.0, std::round(ticks)));
+	state.tickAccumulator = std::max(ticks - steps, -FIXED_MAX_DEBT);
+	return steps;
+}
+
+inline StepCountMode selectStepCountMode(bool physicsBypass, bool legacyBypass, bool fixedBypass = false) {
+	if (!physicsBypass) return StepCountMode::Vanilla;
+	if (legacyBypass) return StepCountMode::Legacy;
+	if (fixedBypass) return StepCountMode::Fixed;
+	return StepCountMode::Modern;
+}
+
+inline int calculateStepCount(StepCountMode mode, StepCountState& state, float delta, float timewarp) {
+	switch (mode) {
+	case StepCountMode::Vanilla: return StepCountStrategy<StepCountMode::Vanilla>::calculate(state, delta, timewarp);
+	case StepCountMode::Legacy: return StepCountStrategy<StepCountMode::Legacy>::calculate(state, delta, timewarp);
+	case StepCountMode::Modern: return StepCountStrategy<StepCountMode::Modern>::calculate(state, delta, timewarp);
+	case StepCountMode::Fixed: return StepCountStrategy<StepCountMode::Fixed>::calculate(state, delta, timewarp);
+	}
+	return 1;
+}
+
+/*
+Picks the mode from state on every call, for the tools and benchmarks.
+*/
+int calculateStepCount(StepCountState& state, float delta, float timewarp, bool forceVanilla);
+
+/*
+Pop the next step, dispatching the input of the previous step first.
+Dispatch is called as dispatch(const InputEvent&).
+*/
+template <typename Dispatch>
+Step popStepQueue(StepScheduler& s, Dispatch&& dispatch) {
+	if (!hasNextStep(s)) return EMPTY_STEP;
+
+	Step front = s.stepQueue.front();
+
+	if (s.nextInput != NO_INPUT) {
+		for (uint16_t i = s.nextInput; i < s.nextInput + s.nextInputCount; i++) dispatch(s.inputs[i]);
+	}
+
+	s.nextInput = front.inputIndex;
+	s.nextInputCount = front.inputCount;
+	s.stepQueue.pop_front();
+
+	return front;
+}
+
+/*
+Click on Steps only applies inputs between steps, so it has no use for substeps or a plan.
+The frame's inputs are binned by step like for buildStepQueue, minus the fractions, and each step (tick) gets its inputs in one go.
+Ticks count in plannedSteps like planned steps do, so unfinished frames are handled the same way.
+Switching to the step queue mid-frame plans nothing more for that frame, the next frame is built for the new mode.
+*/
+void buildTickBuckets(StepScheduler& s, int stepCount);
+
+/*
+Dispatch the inputs of the next tick, as dispatch(const InputEvent* inputs, size_t count), only if it has any.
+Returns false once every tick of the frame is done.
+*/
+template <typename Dispatch>
+bool dispatchTick(StepScheduler& s, Dispatch&& dispatch) {
+	if (s.plannedSteps >= s.planSteps) return false;
+
+	// the inputs are sorted, so every tick's are the run at inputHead
+	const uint32_t tick = static_cast<uint32_t>(s.plannedSteps++);
+	size_t end = s.inputHead;
+	while (end < s.inputCount && s.inputSteps[end] <= tick) end++;
+
+	if (end != s.inputHead) {
+		dispatch(s.inputs.data() + s.inputHead, end - s.inputHead);
+		s.inputHead = end;
+	}
+	return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+// the PlayerObject::update split path, generic over the players so it can run without the game
+
+#include "scheduler.hpp"
+#include "timeline.hpp"
+
+/*
+What the rest of the hooks need to know about the step being split:
+updateRotation uses the split flags and the last substep's delta after the loop is done,
+and every player update made while midStep is set goes straight to the original.
+*/
+struct SplitStepState {
+	bool p1Split = false;
+	bool p2Split = false;
+	bool midStep = false;
+	float rotationDelta = 0.0f;
+};
+
+/*
+One input step, run as the substeps planned for it. Players are anything with:
+
+	bool onGround() const;
+	void setOnGround(bool onGround);
+	bool notBuffering() const;        // on the ground, touching a ring, dashing, or in a mode that can't buffer a click
+	bool fallingTowardGround() const; // (yVelocity < 0) ^ upsideDown
+	void update(float delta);
+	void updateRotation(float delta);
+	void checkCollisions(float delta);
+	bool collisionLogClean() const;   // all four logs empty and every last collision at -1
+	void resetCollisionLog();
+
+and dispatch gets every input the steps carry, like the callback of popStepQueue.
+
+It's built from the layer and players the hook already has, so nothing is looked up again per substep.
+run() picks one of the loops below per step: which players split is fixed for the whole step,
+so it's a template parameter instead of a branch per substep, and outside dual mode
+only the loops without a player 2 split are ever taken.
+*/
+template <typename Player1, typename Player2, typename Dispatch>
+class SplitStep {
+public:
+	SplitStep(StepScheduler& s, Timeline& timeline, SplitStepState& state, Player1& p1, Player2& p2, Dispatch& dispatch)
+		: m_scheduler(s), m_timeline(timeline), m_state(state), m_p1(p1), m_p2(p2), m_dispatch(dispatch) {}
+
+	void run(float stepDelta, bool isDual) {
+		const bool p1StartedOnGround = m_p1.onGround();
+		const bool p2StartedOnGround = m_p2.onGround();
+
+		// player 2's predicate doesn't matter outside dual mode, so it isn't worked out
+		m_state.p1Split = m_p1.notBuffering();
+		m_state.p2Split = isDual && m_p2.notBuffering();
+		m_state.midStep = true;
+
+		if (m_state.p1Split) {
+			if (m_state.p2Split) substeps<true, true>(stepDelta, p1StartedOnGround, p2StartedOnGround);
+			else substeps<true, false>(stepDelta, p1StartedOnGround, p2StartedOnGround);
+		}
+		else {
+			if (m_state.p2Split) substeps<false, true>(stepDelta, p1StartedOnGround, p2StartedOnGround);
+			else substeps<false, false>(stepDelta, p1StartedOnGround, p2StartedOnGround);
+		}
+
+		m_state.midStep = false;
+	}
+
+private:
+	template <bool SplitP1, bool SplitP2>
+	void substeps(float stepDelta, bool p1StartedOnGround, bool p2StartedOnGround) {
+		Step step;
+		bool firstLoop = true;
+
+		do {
+			step = popStepQueue(m_scheduler, m_dispatch);
+			TimelineScope substepScope(m_timeline, step.endStep ? "step" : "substep");
+
+			const float substepDelta = stepDelta * step.deltaFactor;
+			m_state.rotationDelta = substepDelta;
+
+			if constexpr (SplitP1) substep(m_p1, step, substepDelta, stepDelta, firstLoop, p1StartedOnGround);
+			else if (step.endStep) m_p1.update(stepDelta);
+
+			if constexpr (SplitP2) substep(m_p2, step, substepDelta, stepDelta, firstLoop, p2StartedOnGround);
+			else if (step.endStep) m_p2.update(stepDelta);
+
+			firstLoop = false;
+		} while (!step.endStep);
+	}
+
+	template <typename Player>
+	void substep(Player& player, const Step& step, float substepDelta, float stepDelta, bool firstLoop, bool startedOnGround) {
+		player.update(substepDelta);
+		if (step.endStep) return;
+
+		if (firstLoop && player.fallingTowardGround()) player.setOnGround(startedOnGround);
+
+		// CRITICAL FIX: Always use stepDelta for collision detection (matches vanilla)
+		// Original code used 0.0f or substepDelta here, which was wrong
+		{
+			TimelineScope collisionScope(m_timeline, "checkCollisions");
+			player.checkCollisions(stepDelta);
+		}
+
+		player.updateRotation(substepDelta);
+
+		// most substeps don't touch anything, and clearing four empty arrays isn't free
+		if (!player.collisionLogClean()) player.resetCollisionLog();
+	}
+
+	StepScheduler& m_scheduler;
+	Timeline& m_timeline;
+	SplitStepState& m_state;
+	Player1& m_p1;
+	Player2& m_p2;
+	Dispatch& m_dispatch;
+};
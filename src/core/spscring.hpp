@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+Bounded single-producer/single-consumer ring.
+push() is wait-free and only ever called from one thread, front()/pop()/clear() only from another.
+*/
+template <typename T, size_t Capacity>
+class SpscRing {
+	static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+	bool push(const T& value) {
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_cachedTail == Capacity) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head - m_cachedTail == Capacity) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		m_buffer[head & (Capacity - 1)] = value;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	const T* front() {
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_cachedHead) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail == m_cachedHead) return nullptr;
+		}
+		return &m_buffer[tail & (Capacity - 1)];
+	}
+
+	void pop() {
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	void clear() {
+		m_cachedHead = m_head.load(std::memory_order_acquire);
+		m_tail.store(m_cachedHead, std::memory_order_release);
+	}
+
+	uint64_t dropped() const {
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	// producer side
+	alignas(64) std::atomic<size_t> m_head{ 0 };
+	size_t m_cachedTail = 0;
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	// consumer side
+	alignas(64) std::atomic<size_t> m_tail{ 0 };
+	size_t m_cachedHead = 0;
+
+	alignas(64) std::array<T, Capacity> m_buffer{};
+};
@@ -0,0 +1,221 @@
+#include "stepbins.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+#ifdef CBF_STEP_BINS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CBF_TARGET(features) __attribute__((target(features)))
+#else
+#define CBF_TARGET(features)
+#endif
+
+static_assert(sizeof(InputEvent) == 16 && offsetof(InputEvent, time) == 0, "the vector paths load two times per 32 bytes");
+
+namespace {
+	// Fractions is false for binInputTicks, which skips their division and leaves fractions alone
+	template <bool Fractions>
+	void binOne(TimestampType time, TimestampType planStart, TimestampType stepDelta, uint32_t& step, double* fraction) {
+		// inputs from before the frame were held back by a hitch and apply right at its start
+		const TimestampType offset = std::max<TimestampType>(0, time - planStart);
+		const TimestampType quotient = offset / stepDelta;
+		step = static_cast<uint32_t>(std::min<TimestampType>(quotient, std::numeric_limits<uint32_t>::max()));
+		if constexpr (Fractions) *fraction = static_cast<double>(offset % stepDelta) / stepDelta;
+	}
+
+	/*
+	The vector paths divide with a 32.32 fixed point reciprocal, which is exact after one correction
+	as long as offsets and stepDelta fit in 32 bits. Since inputs are sorted, the ones that don't
+	(from before the frame, or absurdly far after it) are all at the ends and go through binOne.
+	*/
+	constexpr TimestampType VECTOR_OFFSET_LIMIT = TimestampType(1) << 32;
+	constexpr TimestampType VECTOR_DELTA_LIMIT = TimestampType(1) << 31; // remainders have to convert from int32
+
+	struct VectorRange {
+		size_t begin;
+		size_t end;
+	};
+
+	VectorRange vectorRange(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta) {
+		if (stepDelta < 2 || stepDelta >= VECTOR_DELTA_LIMIT) return { count, count };
+
+		size_t begin = 0;
+		while (begin < count && inputs[begin].time - planStart < 0) begin++;
+		size_t end = count;
+		while (end > begin && inputs[end - 1].time - planStart >= VECTOR_OFFSET_LIMIT) end--;
+		return { begin, end };
+	}
+
+	template <bool Fractions>
+	void binScalar(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+		for (size_t i = 0; i < count; i++) {
+			binOne<Fractions>(inputs[i].time, planStart, stepDelta, steps[i], fractions + i);
+		}
+	}
+}
+
+#ifdef CBF_STEP_BINS_X86
+
+namespace {
+	template <bool Fractions>
+	void binSse2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+		const VectorRange range = vectorRange(inputs, count, planStart, stepDelta);
+		for (size_t i = 0; i < range.begin; i++) binOne<Fractions>(inputs[i].time, planStart, stepDelta, steps[i], fractions + i);
+
+		const __m128i start = _mm_set1_epi64x(planStart);
+		const __m128i delta = _mm_set1_epi64x(stepDelta);
+		const __m128i reciprocal = _mm_set1_epi64x(static_cast<int64_t>((uint64_t(1) << 32) / static_cast<uint64_t>(stepDelta)));
+		const __m128i one = _mm_set1_epi64x(1);
+		const __m128d deltaDouble = _mm_set1_pd(static_cast<double>(stepDelta));
+
+		size_t i = range.begin;
+		for (; i + 2 <= range.end; i += 2) {
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&inputs[i]));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&inputs[i + 1]));
+			const __m128i offset = _mm_sub_epi64(_mm_unpacklo_epi64(a, b), start);
+
+			// quotient is at most one too small, the remainder is then in [delta, 2 * delta)
+			__m128i quotient = _mm_srli_epi64(_mm_mul_epu32(offset, reciprocal), 32);
+			__m128i remainder = _mm_sub_epi64(offset, _mm_mul_epu32(quotient, delta));
+			const __m128i over = _mm_sub_epi64(remainder, delta);
+			const __m128i carry = _mm_xor_si128(_mm_srli_epi64(over, 63), one); // 1 where remainder >= delta
+			quotient = _mm_add_epi64(quotient, carry);
+			remainder = _mm_sub_epi64(remainder, _mm_and_si128(delta, _mm_sub_epi64(_mm_setzero_si128(), carry)));
+
+			// both fit in 32 bits, pack the low halves
+			const __m128i quotient32 = _mm_shuffle_epi32(quotient, _MM_SHUFFLE(3, 1, 2, 0));
+			const __m128i remainder32 = _mm_shuffle_epi32(remainder, _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&steps[i]), quotient32);
+			if constexpr (Fractions) _mm_storeu_pd(&fractions[i], _mm_div_pd(_mm_cvtepi32_pd(remainder32), deltaDouble));
+		}
+
+		for (; i < count; i++) binOne<Fractions>(inputs[i].time, planStart, stepDelta, steps[i], fractions + i);
+	}
+
+	template <bool Fractions>
+	CBF_TARGET("avx2")
+	void binAvx2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+		const VectorRange range = vectorRange(inputs, count, planStart, stepDelta);
+		for (size_t i = 0; i < range.begin; i++) binOne<Fractions>(inputs[i].time, planStart, stepDelta, steps[i], fractions + i);
+
+		const __m256i start = _mm256_set1_epi64x(planStart);
+		const __m256i delta = _mm256_set1_epi64x(stepDelta);
+		const __m256i deltaMinusOne = _mm256_set1_epi64x(stepDelta - 1);
+		const __m256i reciprocal = _mm256_set1_epi64x(static_cast<int64_t>((uint64_t(1) << 32) / static_cast<uint64_t>(stepDelta)));
+		const __m256i packLow = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+		const __m256d deltaDouble = _mm256_set1_pd(static_cast<double>(stepDelta));
+
+		size_t i = range.begin;
+		for (; i + 4 <= range.end; i += 4) {
+			// inputs i, i + 1 in a and i + 2, i + 3 in b, the unpack leaves their times in the order i, i + 2, i + 1, i + 3
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&inputs[i]));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&inputs[i + 2]));
+			const __m256i times = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+			const __m256i offset = _mm256_sub_epi64(times, start);
+
+			__m256i quotient = _mm256_srli_epi64(_mm256_mul_epu32(offset, reciprocal), 32);
+			__m256i remainder = _mm256_sub_epi64(offset, _mm256_mul_epu32(quotient, delta));
+			const __m256i over = _mm256_cmpgt_epi64(remainder, deltaMinusOne); // all ones where remainder >= delta
+			quotient = _mm256_sub_epi64(quotient, over);
+			remainder = _mm256_sub_epi64(remainder, _mm256_and_si256(delta, over));
+
+			const __m128i quotient32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(quotient, packLow));
+			const __m128i remainder32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(remainder, packLow));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&steps[i]), quotient32);
+			if constexpr (Fractions) _mm256_storeu_pd(&fractions[i], _mm256_div_pd(_mm256_cvtepi32_pd(remainder32), deltaDouble));
+		}
+
+		for (; i < count; i++) binOne<Fractions>(inputs[i].time, planStart, stepDelta, steps[i], fractions + i);
+	}
+
+	CBF_TARGET("xsave")
+	uint64_t readXcr0() {
+		return _xgetbv(0);
+	}
+}
+
+bool cpuHasAvx2() {
+	static const bool hasAvx2 = []() {
+		unsigned int regs[4]{};
+#ifdef _MSC_VER
+		__cpuid(reinterpret_cast<int*>(regs), 1);
+#else
+		__cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		const bool osxsave = regs[2] & (1u << 27);
+		const bool avx = regs[2] & (1u << 28);
+		if (!osxsave || !avx || (readXcr0() & 0x6) != 0x6) return false; // the OS has to save the ymm registers
+
+#ifdef _MSC_VER
+		__cpuidex(reinterpret_cast<int*>(regs), 7, 0);
+#else
+		__cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		return (regs[1] & (1u << 5)) != 0;
+	}();
+	return hasAvx2;
+}
+
+#endif
+
+void binInputStepsScalar(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+	binScalar<true>(inputs, count, planStart, stepDelta, steps, fractions);
+}
+
+void binInputTicksScalar(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps) {
+	binScalar<false>(inputs, count, planStart, stepDelta, steps, nullptr);
+}
+
+#ifdef CBF_STEP_BINS_X86
+
+void binInputStepsSse2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+	binSse2<true>(inputs, count, planStart, stepDelta, steps, fractions);
+}
+
+void binInputStepsAvx2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+	binAvx2<true>(inputs, count, planStart, stepDelta, steps, fractions);
+}
+
+void binInputTicksSse2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps) {
+	binSse2<false>(inputs, count, planStart, stepDelta, steps, nullptr);
+}
+
+void binInputTicksAvx2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps) {
+	binAvx2<false>(inputs, count, planStart, stepDelta, steps, nullptr);
+}
+
+#endif
+
+// below this the setup of the vector paths isn't worth it
+constexpr size_t VECTOR_MIN_INPUTS = 8;
+
+void binInputSteps(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions) {
+#ifdef CBF_STEP_BINS_X86
+	if (count >= VECTOR_MIN_INPUTS) {
+		if (cpuHasAvx2()) binInputStepsAvx2(inputs, count, planStart, stepDelta, steps, fractions);
+		else binInputStepsSse2(inputs, count, planStart, stepDelta, steps, fractions);
+		return;
+	}
+#endif
+	binInputStepsScalar(inputs, count, planStart, stepDelta, steps, fractions);
+}
+
+void binInputTicks(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps) {
+#ifdef CBF_STEP_BINS_X86
+	if (count >= VECTOR_MIN_INPUTS) {
+		if (cpuHasAvx2()) binInputTicksAvx2(inputs, count, planStart, stepDelta, steps);
+		else binInputTicksSse2(inputs, count, planStart, stepDelta, steps);
+		return;
+	}
+#endif
+	binInputTicksScalar(inputs, count, planStart, stepDelta, steps);
+}
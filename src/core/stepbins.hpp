@@ -0,0 +1,37 @@
+#pragma once
+
+// bins a frame's inputs into the steps they land in, in one pass instead of per step
+
+#include <cstddef>
+#include <cstdint>
+
+#include "scheduler.hpp"
+
+/*
+For every input, steps[i] is the step it lands in and fractions[i] how far into that step it is:
+steps = (time - planStart) / stepDelta,
+fractions = ((time - planStart) % stepDelta) / stepDelta.
+Inputs from before the frame, which a hitch held back, are clamped to planStart and get step 0 and fraction 0,
+where the old per-step loop gave them a negative fraction. Everything else bins like that loop did.
+Inputs have to be sorted by time.
+*/
+void binInputSteps(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions);
+
+// steps only, for Click on Steps, which applies inputs between steps and never needs the fractions
+void binInputTicks(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps);
+
+// the individual paths, binInputSteps and binInputTicks pick the widest one the CPU has
+
+void binInputStepsScalar(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions);
+void binInputTicksScalar(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps);
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CBF_STEP_BINS_X86 1
+
+void binInputStepsSse2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions);
+void binInputStepsAvx2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps, double* fractions);
+void binInputTicksSse2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps);
+void binInputTicksAvx2(const InputEvent* inputs, size_t count, TimestampType planStart, TimestampType stepDelta, uint32_t* steps);
+
+bool cpuHasAvx2();
+#endif
@@ -0,0 +1,119 @@
+#include "timeline.hpp"
+
+#include <cstdio>
+
+static thread_local TimelineThread* t_thread = nullptr;
+static thread_local const char* t_threadName = nullptr;
+
+Timeline::~Timeline() {
+	stop();
+}
+
+void Timeline::nameThread(const char* name) {
+	t_threadName = name;
+	if (t_thread) t_thread->name = name;
+}
+
+bool Timeline::start(const std::filesystem::path& path) {
+	if (m_active.load()) return true;
+
+	m_path = path;
+	m_startNs = now();
+	m_collected.clear();
+	m_stopping.store(false);
+	m_collector = std::thread(&Timeline::collectorLoop, this);
+	m_active.store(true);
+	return true;
+}
+
+void Timeline::stop() {
+	if (!m_active.load()) return;
+
+	m_active.store(false);
+	m_stopping.store(true);
+	m_collector.join();
+}
+
+uint64_t Timeline::dropped() const {
+	std::lock_guard lock(m_threadsLock);
+	uint64_t total = 0;
+	for (auto& thread : m_threads) total += thread->ring.dropped();
+	return total;
+}
+
+TimelineThread* Timeline::threadRing() {
+	if (t_thread && t_thread->owner == this) return t_thread;
+
+	auto thread = std::make_unique<TimelineThread>();
+	thread->owner = this;
+	thread->name = t_threadName;
+
+	std::lock_guard lock(m_threadsLock);
+	thread->track = static_cast<uint32_t>(m_threads.size() + 1);
+	t_thread = thread.get();
+	m_threads.push_back(std::move(thread));
+	return t_thread;
+}
+
+void Timeline::push(const TimelineEvent& event) {
+	threadRing()->ring.push(event);
+}
+
+void Timeline::drain() {
+	std::lock_guard lock(m_threadsLock);
+	for (auto& thread : m_threads) {
+		while (const TimelineEvent* event = thread->ring.front()) {
+			// rings may still hold events from the end of the last capture
+			if (event->beginNs >= m_startNs) m_collected.push_back(Collected{ thread->track, *event });
+			thread->ring.pop();
+		}
+	}
+}
+
+void Timeline::collectorLoop() {
+	while (!m_stopping.load()) {
+		drain();
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	drain();
+	write();
+}
+
+void Timeline::write() {
+	std::error_code ec;
+	if (m_path.has_parent_path()) std::filesystem::create_directories(m_path.parent_path(), ec);
+
+#ifdef _WIN32
+	std::FILE* file = _wfopen(m_path.c_str(), L"w");
+#else
+	std::FILE* file = std::fopen(m_path.c_str(), "w");
+#endif
+	if (!file) return;
+
+	// timestamps are in microseconds, relative to the start of the capture
+	std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Click Between Frames\"}}");
+
+	{
+		std::lock_guard lock(m_threadsLock);
+		for (auto& thread : m_threads) {
+			std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				thread->track, thread->name ? thread->name : "unnamed");
+		}
+	}
+
+	for (const Collected& c : m_collected) {
+		const double ts = static_cast<double>(c.event.beginNs - m_startNs) / 1000.0;
+		if (c.event.instant) {
+			std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}", c.event.name, c.track, ts);
+		}
+		else {
+			const double dur = static_cast<double>(c.event.endNs - c.event.beginNs) / 1000.0;
+			std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", c.event.name, c.track, ts, dur);
+		}
+	}
+
+	std::fprintf(file, "\n]}\n");
+	std::fclose(file);
+	m_collected.clear();
+}
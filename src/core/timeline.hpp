@@ -0,0 +1,108 @@
+#pragma once
+
+// on-demand capture of frame phases, written as a Chrome trace (opens in Perfetto and chrome://tracing)
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "spscring.hpp"
+
+struct TimelineEvent {
+	const char* name; // must outlive the capture, use string literals
+	int64_t beginNs;
+	int64_t endNs;    // equal to beginNs for instant events
+	bool instant;
+};
+
+constexpr size_t TIMELINE_RING_CAPACITY = 4096;
+
+class Timeline;
+
+struct TimelineThread {
+	const Timeline* owner;
+	uint32_t track; // tid in the trace file
+	const char* name;
+	SpscRing<TimelineEvent, TIMELINE_RING_CAPACITY> ring;
+};
+
+/*
+Every thread that records gets its own ring the first time it records something while capturing,
+and shows up as its own track. A background thread empties the rings and writes the file when the capture stops.
+While nothing is being captured, recording is a single relaxed load.
+*/
+class Timeline {
+public:
+	~Timeline();
+
+	bool start(const std::filesystem::path& path);
+	void stop();
+
+	bool active() const {
+		return m_active.load(std::memory_order_relaxed);
+	}
+
+	static int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// track name for the calling thread, the name has to be a string literal
+	static void nameThread(const char* name);
+
+	void record(const char* name, int64_t beginNs, int64_t endNs) {
+		if (active()) push(TimelineEvent{ name, beginNs, endNs, false });
+	}
+
+	void instant(const char* name) {
+		if (active()) push(TimelineEvent{ name, now(), 0, true });
+	}
+
+	uint64_t dropped() const;
+
+private:
+	void push(const TimelineEvent& event);
+	TimelineThread* threadRing();
+	void collectorLoop();
+	void drain();
+	void write();
+
+	std::filesystem::path m_path;
+	int64_t m_startNs = 0;
+
+	mutable std::mutex m_threadsLock; // only taken when a thread records for the first time, and by the collector
+	std::vector<std::unique_ptr<TimelineThread>> m_threads;
+
+	struct Collected {
+		uint32_t track;
+		TimelineEvent event;
+	};
+	std::vector<Collected> m_collected;
+
+	std::thread m_collector;
+	std::atomic<bool> m_active{ false };
+	std::atomic<bool> m_stopping{ false };
+};
+
+// times the enclosing scope, costs nothing but the active() check while not capturing
+class TimelineScope {
+public:
+	TimelineScope(Timeline& timeline, const char* name)
+		: m_timeline(timeline), m_name(name), m_begin(timeline.active() ? Timeline::now() : 0) {}
+
+	~TimelineScope() {
+		if (m_begin) m_timeline.record(m_name, m_begin, Timeline::now());
+	}
+
+	TimelineScope(const TimelineScope&) = delete;
+	TimelineScope& operator=(const TimelineScope&) = delete;
+
+private:
+	Timeline& m_timeline;
+	const char* m_name;
+	int64_t m_begin;
+};
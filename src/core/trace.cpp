@@ -0,0 +1,92 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+TraceRecorder::~TraceRecorder() {
+	stop();
+}
+
+bool TraceRecorder::start(const std::filesystem::path& path, int64_t ticksPerSecond) {
+	if (m_active.load()) return true;
+
+	std::error_code ec;
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+
+#ifdef _WIN32
+	m_file = _wfopen(path.c_str(), L"wb");
+#else
+	m_file = std::fopen(path.c_str(), "wb");
+#endif
+	if (!m_file) return false;
+
+	TraceHeader header{};
+	std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.recordSize = sizeof(TraceRecord);
+	header.ticksPerSecond = ticksPerSecond;
+	header.recordCount = 0;
+	std::fwrite(&header, sizeof(header), 1, m_file);
+
+	m_ring = std::make_unique<SpscRing<TraceRecord, TRACE_RING_CAPACITY>>();
+	m_written = 0;
+	m_stopping.store(false);
+	m_writer = std::thread(&TraceRecorder::writerLoop, this);
+	m_active.store(true);
+	return true;
+}
+
+void TraceRecorder::stop() {
+	if (!m_active.load()) return;
+
+	m_active.store(false);
+	m_stopping.store(true);
+	m_writer.join();
+
+	// now that nothing else is written, fill in the record count
+	std::fseek(m_file, offsetof(TraceHeader, recordCount), SEEK_SET);
+	std::fwrite(&m_written, sizeof(m_written), 1, m_file);
+	std::fclose(m_file);
+	m_file = nullptr;
+}
+
+void TraceRecorder::recordInput(const InputEvent& input) {
+	TraceRecord record{};
+	record.kind = TraceInput;
+	record.input = input;
+	m_ring->push(record);
+}
+
+void TraceRecorder::recordFrame(const TraceFrameRecord& frame) {
+	TraceRecord record{};
+	record.kind = TraceFrame;
+	record.frame = frame;
+	m_ring->push(record);
+}
+
+void TraceRecorder::writerLoop() {
+	std::vector<TraceRecord> batch;
+	batch.reserve(TRACE_RING_CAPACITY);
+
+	while (true) {
+		// read the flag first so nothing pushed before stop() is missed
+		const bool stopping = m_stopping.load();
+
+		while (const TraceRecord* record = m_ring->front()) {
+			batch.push_back(*record);
+			m_ring->pop();
+		}
+
+		if (!batch.empty()) {
+			m_written += std::fwrite(batch.data(), sizeof(TraceRecord), batch.size(), m_file);
+			std::fflush(m_file); // keep the file usable if the game gets killed
+			batch.clear();
+		}
+
+		if (stopping) break;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// binary recording of every input and frame that goes through the step scheduler
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
+#include "scheduler.hpp"
+#include "spscring.hpp"
+
+/*
+File layout: one TraceHeader followed by fixed size TraceRecords, little endian.
+Records are 8 byte aligned so the whole file can be mapped and read in place.
+recordCount is written when the recording stops, a crashed recording has 0 there
+and readers should fall back to the file size.
+Version 2 added frameStartTime and buildTime to frame records, readers only take the current version.
+*/
+constexpr char TRACE_MAGIC[8] = { 'C', 'B', 'F', 'T', 'R', 'A', 'C', 'E' };
+constexpr uint32_t TRACE_VERSION = 2;
+
+struct TraceHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	int64_t ticksPerSecond; // resolution of every timestamp in the file
+	uint64_t recordCount;
+};
+
+enum TraceRecordKind : uint32_t {
+	TraceInput = 1, // an input drained from the lanes, belongs to the next frame record
+	TraceFrame = 2
+};
+
+enum TraceFrameFlags : uint32_t {
+	TracePhysicsBypass = 1 << 0,
+	TraceLegacyBypass = 1 << 1,
+	TraceLateCutoff = 1 << 2,
+	TraceFirstFrame = 1 << 3, // the scheduler was reset before this frame
+	TraceClickOnSteps = 1 << 4,
+	TraceFixedBypass = 1 << 5, // the tick rate isn't recorded, replays take it as an option
+	TraceAdaptiveCutoff = 1 << 6
+};
+
+struct TraceFrameRecord {
+	TimestampType currentFrameTime;
+	TimestampType lastFrameTime;
+	double animationInterval;
+	float modifiedDelta;
+	float timewarp;
+	int32_t stepCount;
+	uint32_t flags;
+	TimestampType frameStartTime; // onFrameStart, currentFrameTime before any cutoff moved it
+	TimestampType buildTime;      // buildStepQueue
+};
+
+struct TraceRecord {
+	uint32_t kind;
+	uint32_t reserved;
+	union {
+		InputEvent input;
+		TraceFrameRecord frame;
+	};
+};
+
+static_assert(sizeof(TraceHeader) == 32);
+static_assert(sizeof(InputEvent) == 16);
+static_assert(sizeof(TraceRecord) == 64);
+
+constexpr size_t TRACE_RING_CAPACITY = 8192;
+
+/*
+Records are pushed from the main thread into a ring, a background thread writes them to disk.
+If the writer falls behind, records are dropped instead of blocking the frame.
+*/
+class TraceRecorder {
+public:
+	~TraceRecorder();
+
+	bool start(const std::filesystem::path& path, int64_t ticksPerSecond);
+	void stop();
+
+	bool active() const {
+		return m_active.load(std::memory_order_relaxed);
+	}
+
+	void recordInput(const InputEvent& input);
+	void recordFrame(const TraceFrameRecord& frame);
+
+	uint64_t dropped() const {
+		return m_ring ? m_ring->dropped() : 0;
+	}
+
+private:
+	void writerLoop();
+
+	std::unique_ptr<SpscRing<TraceRecord, TRACE_RING_CAPACITY>> m_ring;
+	std::thread m_writer;
+	std::FILE* m_file = nullptr;
+	uint64_t m_written = 0;
+
+	std::atomic<bool> m_active{ false };
+	std::atomic<bool> m_stopping{ false };
+};
@@ -5,10 +5,35 @@
 
 #include <Geode/Geode.hpp>
 
+#include "core/scheduler.hpp"
+#include "core/inputlanes.hpp"
+#include "core/trace.hpp"
+#include "core/keybinds.hpp"
+#include "core/heldinputs.hpp"
+#include "core/metrics.hpp"
+#include "core/timeline.hpp"
+#include "core/predictor.hpp"
+#include "core/inputgate.hpp"
+#include "core/clock.hpp"
+#include "core/perfhud.hpp"
+#include "core/splitstep.hpp"
+#include "core/cutoff.hpp"
+
 using namespace geode::prelude;
 
-using TimestampType = int64_t;
-TimestampType getCurrentTimestamp();
+// the platform's real clock, implemented in windows.cpp, android.cpp and apple.mm
+const Clock& platformClock();
+
+// what the mod runs against, the platform clock unless something swaps in e.g. a VirtualClock
+extern const Clock* gameClock;
+
+inline TimestampType getCurrentTimestamp() {
+	return gameClock->now();
+}
+
+inline TimestampType getTimestampFrequency() { // timestamps per second
+	return gameClock->frequency();
+}
 
 enum GameAction : int {
 	p1Jump = 0,
@@ -24,29 +49,12 @@ enum State : bool {
 	Press = 1
 };
 
-struct InputEvent {
-	TimestampType time;
-	PlayerButton inputType;
-	bool inputState;
-	bool isPlayer1;
-};
-
-struct Step {
-	InputEvent input;
-	double deltaFactor;
-	bool endStep;
-};
-
-// Keep original architecture - dynamic containers
-extern std::deque<struct InputEvent> inputQueue;
-extern std::deque<struct InputEvent> inputQueueCopy;
-extern std::deque<struct Step> stepQueue;
-
-extern std::array<std::unordered_set<size_t>, 6> inputBinds;
-extern std::unordered_set<uint16_t> heldInputs;
+extern InputLanes inputLanes;
+extern Timeline timeline;
+extern InputGate inputGate;
 
-extern std::mutex inputQueueLock;
-extern std::mutex keybindsLock;
+extern KeyBindings keyBindings;
+extern HeldInputs heldInputs;
 
 extern std::atomic<bool> enableRightClick;
 extern std::atomic<bool> softToggle;
@@ -0,0 +1,120 @@
+#pragma once
+
+// turns evdev events into LinuxInputEvents, kept free of Wine and libevdev so it can be benchmarked natively
+
+#include <linux/input.h>
+
+#include <array>
+#include <cstdint>
+
+#include "../linuxshared.hpp"
+
+struct libevdev;
+
+inline int64_t convert_time(timeval t) {
+	// FILETIME, to match GetSystemTimePreciseAsFileTime on the game side
+	return ((static_cast<int64_t>(t.tv_sec) + 11644473600) * 10000000) + (t.tv_usec * 10);
+}
+
+inline uint16_t convert_scan_code(uint16_t code) {
+	static constexpr std::array<uint16_t, 116 - 96> special_codes = []() {
+		std::array<uint16_t, 116 - 96> map{};
+		map[96 - 96] = 0xE01C;
+		map[97 - 96] = 0xE01D;
+		map[98 - 96] = 0xE035;
+		map[100 - 96] = 0xE038;
+		map[102 - 96] = 0xE047;
+		map[103 - 96] = 0xE048;
+		map[104 - 96] = 0xE049;
+		map[105 - 96] = 0xE04B;
+		map[106 - 96] = 0xE04D;
+		map[107 - 96] = 0xE04F;
+		map[108 - 96] = 0xE050;
+		map[109 - 96] = 0xE051;
+		map[110 - 96] = 0xE052;
+		map[111 - 96] = 0xE053;
+		map[113 - 96] = 0xE020;
+		map[114 - 96] = 0xE02E;
+		map[115 - 96] = 0xE030;
+		return map;
+		}();
+
+	return (code > 96) && (code < 116) ? special_codes[code - 96] : code;
+}
+
+// the first matching capability wins, in the same order the helper always checked them
+inline DeviceType classify_device(bool has_rel, bool has_key_1, bool direct, bool buttonpad, bool gamepad) {
+	if (has_rel) return MOUSE;
+	if (has_key_1) return KEYBOARD;
+	if (direct) return TOUCHSCREEN;
+	if (buttonpad) return TOUCHPAD;
+	if (gamepad) return CONTROLLER;
+	return UNKNOWN;
+}
+
+// 32 fractional bits keep the rounding below half an output unit for any 32 bit axis range
+constexpr int AXIS_SCALE_SHIFT = 32;
+constexpr int64_t AXIS_SCALE_HALF = int64_t(1) << (AXIS_SCALE_SHIFT - 1);
+
+// maps [abs_min, abs_max] onto the range the game expects: (((value - abs_min) * multiplier + half) >> AXIS_SCALE_SHIFT) + out_min, both ends exactly
+struct AxisScale {
+	int32_t abs_min = 0;
+	int32_t out_min = 0;
+	int64_t multiplier = 0;
+};
+
+/*
+Everything needed to decode a device's events, worked out once when it is added.
+The epoll entry of the device points at this.
+*/
+struct EvdevDevice {
+	struct libevdev* dev = nullptr;
+	DeviceType type = UNKNOWN;
+	std::array<AxisScale, ABS_CNT> axes{};
+};
+
+inline void set_axis_range(EvdevDevice& device, unsigned int code, int32_t abs_min, int32_t abs_max) {
+	if (code >= ABS_CNT) return;
+
+	// triggers go to 0-255 like XInput, sticks to a signed 16 bit range
+	const bool trigger = code == ABS_Z || code == ABS_RZ;
+	const int64_t out_min = trigger ? 0 : -32768;
+	const int64_t out_max = trigger ? 255 : 32767;
+
+	AxisScale& axis = device.axes[code];
+	axis.abs_min = abs_min;
+	axis.out_min = static_cast<int32_t>(out_min);
+
+	// rounded rather than truncated, a truncated multiplier falls short of out_max at full scale (254 for a 0-1023 trigger)
+	const int64_t range = static_cast<int64_t>(abs_max) - abs_min;
+	axis.multiplier = range > 0 ? (((out_max - out_min) << AXIS_SCALE_SHIFT) + range / 2) / range : 0;
+}
+
+inline int32_t scale_axis(const AxisScale& axis, int32_t value) {
+	return static_cast<int32_t>(((static_cast<int64_t>(value) - axis.abs_min) * axis.multiplier + AXIS_SCALE_HALF) >> AXIS_SCALE_SHIFT) + axis.out_min;
+}
+
+// event types that can make it to the game, everything else is filtered out when the device is opened
+inline bool forwards_event_type(DeviceType type, unsigned int ev_type) {
+	return ev_type == EV_KEY || (ev_type == EV_ABS && type == CONTROLLER);
+}
+
+// returns false for events the game doesn't care about
+inline bool decode_event(const EvdevDevice& device, const input_event& ev, LinuxInputEvent& out) {
+	uint16_t code = ev.code;
+	int32_t value = ev.value;
+
+	if (ev.type == EV_KEY) {
+		if (ev.value == 2) return false; // autorepeat
+		if (device.type == KEYBOARD) code = convert_scan_code(code);
+	}
+	else if (ev.type == EV_ABS && device.type == CONTROLLER && ev.code < ABS_CNT) {
+		value = scale_axis(device.axes[ev.code], value);
+	}
+	else {
+		return false;
+	}
+
+	out = LinuxInputEvent{ convert_time(ev.time), ev.type, code, value, device.type };
+	return true;
+}
@@ -9,6 +9,7 @@
 #include <sys/ioctl.h>
 #include <sys/epoll.h>
 #include <sys/inotify.h>
+#include <sys/eventfd.h>
 #include <bits/stdc++.h>
 
 #include <iostream>
@@ -17,25 +18,11 @@
 #include <vector>
 #include <atomic>
 #include <array>
+#include <memory>
+
+#include "../linuxshared.hpp"
+#include "evdev-decode.hpp"
 
-enum DeviceType : int8_t {
-	MOUSE,
-	TOUCHPAD,
-	KEYBOARD,
-	TOUCHSCREEN,
-	CONTROLLER,
-	UNKNOWN
-};
-
-struct __attribute__((packed)) LinuxInputEvent {
-	LARGE_INTEGER time;
-	USHORT type;
-	USHORT code;
-	int value;
-	DeviceType deviceType;
-};
-
-constexpr size_t BUFFER_SIZE = 20;
 constexpr int MAX_EVENTS = 10;
 
 #define INOTIFY_EVENT_SIZE  ( sizeof (struct inotify_event) )
@@ -43,56 +30,52 @@ constexpr int MAX_EVENTS = 10;
 
 std::atomic<bool> should_quit{ false };
 
-void stop(int i) {
-	should_quit.store(true);
-}
+// written to wake the main loop up when it should quit
+int shutdown_fd = -1;
 
-LARGE_INTEGER convert_time(timeval t) {
-	LARGE_INTEGER wft;
-	wft.QuadPart = ((static_cast<ULONGLONG>(t.tv_sec) + 11644473600) * 10000000) + (t.tv_usec * 10);
-	return wft;
+void request_shutdown() {
+	should_quit.store(true);
+	uint64_t one = 1;
+	(void)!write(shutdown_fd, &one, sizeof(one));
 }
 
-USHORT convert_scan_code(USHORT code) {
-	static const std::array<uint16_t, 116 - 96> special_codes = []() {
-		std::array<uint16_t, 116 - 96> map{};
-		map[96 - 96] = 0xE01C;
-		map[97 - 96] = 0xE01D;
-		map[98 - 96] = 0xE035;
-		map[100 - 96] = 0xE038;
-		map[102 - 96] = 0xE047;
-		map[103 - 96] = 0xE048;
-		map[104 - 96] = 0xE049;
-		map[105 - 96] = 0xE04B;
-		map[106 - 96] = 0xE04D;
-		map[107 - 96] = 0xE04F;
-		map[108 - 96] = 0xE050;
-		map[109 - 96] = 0xE051;
-		map[110 - 96] = 0xE052;
-		map[111 - 96] = 0xE053;
-		map[113 - 96] = 0xE020;
-		map[114 - 96] = 0xE02E;
-		map[115 - 96] = 0xE030;
-		return map;
-		}();
-
-	return (code > 96) && (code < 116) ? special_codes[code - 96] : code;
+void stop(int i) {
+	request_shutdown(); // only uses async-signal-safe calls
 }
 
 DWORD WINAPI gd_watchdog(LPVOID) {
 	HANDLE gdMutex = OpenMutex(SYNCHRONIZE, FALSE, "CBFWatchdogMutex");
 	if (gdMutex == NULL) {
 		std::cerr << "[CBF] Failed to open mutex: " << GetLastError() << std::endl;
-		should_quit.store(true);
+		request_shutdown();
 		return 1;
 	}
 	WaitForSingleObject(gdMutex, INFINITE);
 	ReleaseMutex(gdMutex);
-	should_quit.store(true);
+	request_shutdown();
 	return 0;
 }
 
-void add_input_device(std::string path, int epoll_fd, std::vector<struct libevdev*>& devices, std::vector<std::string>& devices_paths) {
+/*
+Stop the device from reporting event types the game never gets, mostly mouse motion.
+EVIOCSMASK drops them in the kernel, so motion-only packets don't even wake the helper up.
+On kernels without it libevdev still throws them away before they get decoded.
+EV_SYN stays enabled: readers are only woken up on SYN_REPORT, and packets that end up empty are skipped.
+*/
+void filter_device_events(const EvdevDevice& device, int fd) {
+	for (unsigned int type = EV_KEY; type < EV_CNT; type++) {
+		if (!libevdev_has_event_type(device.dev, type) || forwards_event_type(device.type, type)) continue;
+
+#ifdef EVIOCSMASK
+		// an empty code bitmap masks the whole type
+		input_mask mask{ type, 0, 0 };
+		if (ioctl(fd, EVIOCSMASK, &mask) == 0) continue;
+#endif
+		libevdev_disable_event_type(device.dev, type);
+	}
+}
+
+void add_input_device(std::string path, int epoll_fd, std::vector<std::unique_ptr<EvdevDevice>>& devices, std::vector<std::string>& devices_paths) {
 	int fd = open(path.c_str(), O_RDONLY);
 	if (fd == -1) {
 		if (errno == 2 || errno == 13) return;
@@ -110,9 +93,28 @@ void add_input_device(std::string path, int epoll_fd, std::vector<struct libevde
 
 	int bus = libevdev_get_id_bustype(dev);
 	if (bus == BUS_USB || bus == BUS_BLUETOOTH || bus == BUS_I8042 || bus == BUS_VIRTUAL) {
+		// capabilities don't change while the device is open, so classify it once instead of per event
+		auto device = std::make_unique<EvdevDevice>();
+		device->dev = dev;
+		device->type = classify_device(
+			libevdev_has_event_type(dev, EV_REL),
+			libevdev_has_event_code(dev, EV_KEY, KEY_1),
+			libevdev_has_property(dev, INPUT_PROP_DIRECT),
+			libevdev_has_property(dev, INPUT_PROP_BUTTONPAD),
+			libevdev_has_event_code(dev, EV_KEY, BTN_GAMEPAD)
+		);
+		if (device->type == CONTROLLER) {
+			for (unsigned int code = 0; code < ABS_CNT; code++) {
+				if (libevdev_has_event_code(dev, EV_ABS, code)) {
+					set_axis_range(*device, code, libevdev_get_abs_minimum(dev, code), libevdev_get_abs_maximum(dev, code));
+				}
+			}
+		}
+		filter_device_events(*device, fd);
+
 		epoll_event ev;
 		ev.events = EPOLLIN;
-		ev.data.ptr = dev;
+		ev.data.ptr = device.get();
 		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
 			std::cerr << "[CBF] Failed to add fd to epoll for " << path << ": " << strerror(errno) << std::endl;
 			libevdev_free(dev);
@@ -120,7 +122,7 @@ void add_input_device(std::string path, int epoll_fd, std::vector<struct libevde
 			return;
 		}
 
-		devices.push_back(dev);
+		devices.push_back(std::move(device));
 		devices_paths.push_back(path);
 		std::cerr << "[CBF] Added device: " << path << std::endl;
 	}
@@ -130,33 +132,52 @@ void add_input_device(std::string path, int epoll_fd, std::vector<struct libevde
 	}
 }
 
-void remove_input_device(std::string path, std::vector<struct libevdev*>& devices, std::vector<std::string>& devices_paths) {
-	auto finder = std::find(devices_paths.begin(), devices_paths.end(), path);
-	int index = std::distance(devices_paths.begin(), finder);
-	if (finder == devices_paths.end()) {
-		std::cerr << "[CBF] Input device scheduled to be removed was not found." << std::endl;
-		return;
-	}
+// takes the device out of epoll first, a device that's gone would otherwise keep it waking up
+void drop_input_device(size_t index, int epoll_fd, std::vector<std::unique_ptr<EvdevDevice>>& devices, std::vector<std::string>& devices_paths) {
+	int fd = libevdev_get_fd(devices[index]->dev);
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+	libevdev_free(devices[index]->dev);
 
-	close(libevdev_get_fd(devices[index]));
-	libevdev_free(devices[index]);
+	std::cerr << "[CBF] Removed device: " << devices_paths[index] << std::endl;
 	devices.erase(devices.begin() + index);
 	devices_paths.erase(devices_paths.begin() + index);
+}
 
-	std::cerr << "[CBF] Removed device: " << path << std::endl;
+void remove_input_device(std::string path, int epoll_fd, std::vector<std::unique_ptr<EvdevDevice>>& devices, std::vector<std::string>& devices_paths) {
+	auto finder = std::find(devices_paths.begin(), devices_paths.end(), path);
+	if (finder == devices_paths.end()) return; // already dropped when its fd hung up, or never added
+
+	drop_input_device(std::distance(devices_paths.begin(), finder), epoll_fd, devices, devices_paths);
 }
 
-int32_t normalize_axis(struct libevdev* dev, int code, int val, int min, int max) {
-	int abs_min = libevdev_get_abs_minimum(dev, code);
-	int abs_max = libevdev_get_abs_maximum(dev, code);
-	float normalized = static_cast<float>(val - abs_min) / static_cast<float>(abs_max - abs_min);
-	int32_t scaled = static_cast<int32_t>(normalized * (max - min)) + min;
-	return scaled;
+void handle_hotplug(int inotify_fd, char* buffer, const char* input_dir, int epoll_fd, std::vector<std::unique_ptr<EvdevDevice>>& devices, std::vector<std::string>& devices_paths) {
+	int len;
+	while ((len = read(inotify_fd, buffer, INOTIFY_BUF_LEN)) > 0) {
+		int i = 0;
+		while (i < len) {
+			struct inotify_event* event = (struct inotify_event*)&buffer[i];
+			i += INOTIFY_EVENT_SIZE + event->len;
+
+			if (!event->len) continue;
+
+			std::string device_name = std::string(event->name);
+			std::string path = std::string(input_dir) + device_name;
+			if (device_name.find("event") != 0) continue;
+
+			if (event->mask & IN_ATTRIB) {
+				add_input_device(path, epoll_fd, devices, devices_paths);
+			}
+			else if (event->mask & IN_DELETE) {
+				remove_input_device(path, epoll_fd, devices, devices_paths);
+			}
+		}
+	}
 }
 
 int main() {
 	std::cerr << "[CBF] Linux input program started" << std::endl;
-	std::vector<struct libevdev*> devices;
+	std::vector<std::unique_ptr<EvdevDevice>> devices;
 	std::vector<std::string> devices_paths;
 
 	const char* input_dir = "/dev/input/";
@@ -167,6 +188,12 @@ int main() {
 		return 1;
 	}
 
+	shutdown_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (shutdown_fd == -1) {
+		std::cerr << "[CBF] Failed to create shutdown eventfd: " << strerror(errno) << std::endl;
+		return 1;
+	}
+
 	int inotify_fd = inotify_init1(IN_NONBLOCK);
 	if (inotify_fd < 0) {
 		std::cerr << "[CBF] Failed to create inotify instance: " << strerror(errno) << std::endl;
@@ -178,7 +205,21 @@ int main() {
 		std::cerr << "[CBF] Failed to create an inotify watch: " << strerror(errno) << std::endl;
 		return 1;
 	}
-	char inotify_buffer[INOTIFY_BUF_LEN];
+	alignas(struct inotify_event) char inotify_buffer[INOTIFY_BUF_LEN];
+
+	// devices are identified by their EvdevDevice, these two by the address of their fd
+	epoll_event control_ev;
+	control_ev.events = EPOLLIN;
+	control_ev.data.ptr = &inotify_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &control_ev) == -1) {
+		std::cerr << "[CBF] Failed to add inotify to epoll: " << strerror(errno) << std::endl;
+		return 1;
+	}
+	control_ev.data.ptr = &shutdown_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, shutdown_fd, &control_ev) == -1) {
+		std::cerr << "[CBF] Failed to add shutdown eventfd to epoll: " << strerror(errno) << std::endl;
+		return 1;
+	}
 
 	DIR* dir = opendir(input_dir);
 	struct dirent* entry;
@@ -200,18 +241,16 @@ int main() {
 		return 1;
 	}
 
-	LPVOID pBuf = MapViewOfFile(hSharedMem, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LinuxInputEvent) * BUFFER_SIZE);
+	LPVOID pBuf = MapViewOfFile(hSharedMem, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LinuxInputRing));
 	if (pBuf == NULL) {
 		std::cerr << "[CBF] Failed to map view of file: " << GetLastError() << std::endl;
 		CloseHandle(hSharedMem);
 		return 1;
 	}
 
-	LinuxInputEvent* shared_events = static_cast<LinuxInputEvent*>(pBuf);
-
-	HANDLE hMutex = OpenMutex(SYNCHRONIZE, FALSE, "CBFLinuxMutex");
-	if (hMutex == NULL) {
-		std::cerr << "[CBF] Failed to open mutex: " << GetLastError() << std::endl;
+	LinuxInputRing* ring = static_cast<LinuxInputRing*>(pBuf);
+	if (ring->magic != LINUX_RING_MAGIC || ring->version != LINUX_RING_VERSION || ring->capacity != LINUX_RING_CAPACITY) {
+		std::cerr << "[CBF] Shared memory layout doesn't match this helper (version " << ring->version << ")" << std::endl;
 		UnmapViewOfFile(pBuf);
 		CloseHandle(hSharedMem);
 		return 1;
@@ -221,151 +260,99 @@ int main() {
 		std::cerr << "[CBF] No input devices" << std::endl;
 		close(epoll_fd);
 
-		DWORD waitResult = WaitForSingleObject(hMutex, 1000);
-		if (waitResult == WAIT_OBJECT_0) {
-			shared_events[0].type = 3;
-			ReleaseMutex(hMutex);
-		}
-		else if (waitResult != WAIT_TIMEOUT) {
-			std::cerr << "[CBF] Failed to acquire mutex: " << GetLastError() << std::endl;
-		}
+		ring->status.store(LinuxHelperNoDevices, std::memory_order_release);
 
+		UnmapViewOfFile(pBuf);
+		CloseHandle(hSharedMem);
 		return 1;
 	}
 
+	ring->status.store(LinuxHelperRunning, std::memory_order_release);
+	LinuxRingWriter writer(ring);
+
 	std::cerr << "[CBF] Waiting for input events" << std::endl;
 	CreateThread(NULL, 0, gd_watchdog, NULL, 0, NULL);
 
 	epoll_event events[MAX_EVENTS];
+	std::vector<const EvdevDevice*> gone;
 
 	while (!should_quit.load()) {
-
-		int inotify_len = read(inotify_fd, inotify_buffer, INOTIFY_BUF_LEN);
-		if (inotify_len > 0) {
-			int i = 0;
-
-			while (i < inotify_len) {
-				struct inotify_event* event = (struct inotify_event*)&inotify_buffer[i];
-
-				if (event->len) {
-					i += INOTIFY_EVENT_SIZE + event->len;
-
-					std::string device_name = std::string(event->name);
-					std::string path = std::string(input_dir) + device_name;
-					if (device_name.find("event") != 0) continue;
-
-					if (event->mask & IN_ATTRIB) {
-						add_input_device(path, epoll_fd, devices, devices_paths);
-					}
-					else if (event->mask & IN_DELETE) {
-						remove_input_device(path, devices, devices_paths);
-					}
-				}
-			}
-		}
-
-		int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, 1);
+		// block until input, hotplug or shutdown
+		int nfds = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
 		if (nfds == -1) {
 			if (errno == EINTR) continue;
 			std::cerr << "[CBF] Failed to epoll_wait: " << strerror(errno) << std::endl;
 			break;
 		}
 
+		bool hotplug = false;
+		// unplugged devices hang up before inotify reports them, epoll is level triggered so they'd be returned on every wait
+		gone.clear();
+
 		for (int n = 0; n < nfds; ++n) {
-			struct libevdev* dev = static_cast<struct libevdev*>(events[n].data.ptr);
+			if (events[n].data.ptr == &shutdown_fd) break;
+
+			if (events[n].data.ptr == &inotify_fd) {
+				// handled after this batch, removing a device now would free a pointer later entries may still use
+				hotplug = true;
+				continue;
+			}
+
+			const EvdevDevice& device = *static_cast<EvdevDevice*>(events[n].data.ptr);
+			if (events[n].events & (EPOLLHUP | EPOLLERR)) {
+				gone.push_back(&device);
+				continue;
+			}
+
+			struct libevdev* dev = device.dev;
 			struct input_event ev;
+			LinuxInputEvent event;
 
 			while (libevdev_has_event_pending(dev)) {
 				int rc = libevdev_next_event(dev, LIBEVDEV_READ_FLAG_NORMAL, &ev);
 				if (rc != -EAGAIN && rc != 0) {
-					if (rc == -ENODEV) break;
+					if (rc == -ENODEV) {
+						gone.push_back(&device);
+						break;
+					}
 
 					std::cerr << "[CBF] Error reading event: " << strerror(-rc) << std::endl;
 					break;
 				}
 
-				LARGE_INTEGER time = convert_time(ev.time);
-				USHORT code = ev.code;
-				int value = ev.value;
-				DeviceType device_type;
-
-				if (libevdev_has_event_type(dev, EV_REL)) {
-					if (ev.type != EV_KEY || ev.value == 2) {
-						continue;
-					}
-					device_type = MOUSE;
-				}
-				else if (libevdev_has_event_code(dev, EV_KEY, KEY_1)) {
-					if (ev.type != EV_KEY || ev.value == 2) {
-						continue;
-					}
-					device_type = KEYBOARD;
-					code = convert_scan_code(ev.code);
-				}
-				else if (libevdev_has_property(dev, INPUT_PROP_DIRECT)) {
-					if (ev.type != EV_KEY || ev.value == 2) {
-						continue;
-					}
-					device_type = TOUCHSCREEN;
-				}
-				else if (libevdev_has_property(dev, INPUT_PROP_BUTTONPAD)) {
-					if (ev.type != EV_KEY || ev.value == 2) {
-						continue;
-					}
-					device_type = TOUCHPAD;
-				}
-				else if (libevdev_has_event_code(dev, EV_KEY, BTN_GAMEPAD)) {
-					device_type = CONTROLLER;
-					if (ev.type == EV_ABS) {
-						if (ev.code == ABS_Z || ev.code == ABS_RZ) value = normalize_axis(dev, code, value, 0, 255);
-						else value = normalize_axis(dev, code, value, -32768, 32767);
-					}
-					else if (ev.type != EV_KEY || ev.value == 2) {
-						continue;
-					}
-				}
-				else {
-					if (ev.type != EV_KEY || ev.value == 2) {
-						continue;
-					}
-					device_type = UNKNOWN;
-				}
+				if (!decode_event(device, ev, event)) continue;
 
-				DWORD waitResult = WaitForSingleObject(hMutex, 10);
-				if (waitResult == WAIT_OBJECT_0) {
-					for (int i = 0; i < BUFFER_SIZE; i++) {
-						if (shared_events[i].type == 0) {
-							shared_events[i].time = time;
-							shared_events[i].type = ev.type;
-							shared_events[i].code = code;
-							shared_events[i].value = value;
-							shared_events[i].deviceType = device_type;
-							break;
-						}
-					}
-					ReleaseMutex(hMutex);
-				}
-				else if (waitResult != WAIT_TIMEOUT) {
-					std::cerr << "[CBF] Failed to acquire mutex: " << GetLastError() << std::endl;
-				}
+				// dropped events are counted in the ring, the game reports them
+				writer.push(event);
 			}
 		}
+
+		// publish everything from this wakeup at once
+		writer.publish();
+
+		// like hotplug, only after the batch is done with the device pointers
+		for (const EvdevDevice* device : gone) {
+			auto finder = std::find_if(devices.begin(), devices.end(), [&](const auto& d) { return d.get() == device; });
+			if (finder != devices.end()) drop_input_device(std::distance(devices.begin(), finder), epoll_fd, devices, devices_paths);
+		}
+
+		if (hotplug) handle_hotplug(inotify_fd, inotify_buffer, input_dir, epoll_fd, devices, devices_paths);
 	}
 
-	for (auto dev : devices) {
-		int fd = libevdev_get_fd(dev);
+	for (auto& device : devices) {
+		int fd = libevdev_get_fd(device->dev);
 		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
-		libevdev_free(dev);
+		libevdev_free(device->dev);
 		close(fd);
 	}
 
 	close(epoll_fd);
 	inotify_rm_watch(inotify_fd, inotify_watch);
 	close(inotify_fd);
+	close(shutdown_fd);
 
 	UnmapViewOfFile(pBuf);
 	CloseHandle(hSharedMem);
-	CloseHandle(hMutex);
 
 	std::cerr << "[CBF] Linux input program exiting" << std::endl;
 	return 0;
@@ -0,0 +1,87 @@
+#pragma once
+
+// layout of the "LinuxSharedMemory" mapping, shared between the mod and linux-input.cpp
+
+#include <atomic>
+#include <cstdint>
+
+enum DeviceType : int8_t {
+	MOUSE,
+	TOUCHPAD,
+	KEYBOARD,
+	TOUCHSCREEN,
+	CONTROLLER,
+	UNKNOWN
+};
+
+struct LinuxInputEvent {
+	int64_t time; // FILETIME, same clock as getCurrentTimestamp() with the Wine workaround
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+	DeviceType deviceType;
+};
+
+static_assert(sizeof(LinuxInputEvent) == 24);
+
+enum LinuxHelperStatus : uint32_t {
+	LinuxHelperStarting = 0,
+	LinuxHelperRunning = 1,
+	LinuxHelperNoDevices = 2
+};
+
+constexpr uint32_t LINUX_RING_MAGIC = 0x52464243; // "CBFR"
+constexpr uint32_t LINUX_RING_VERSION = 1;
+constexpr uint32_t LINUX_RING_CAPACITY = 256;
+
+static_assert((LINUX_RING_CAPACITY & (LINUX_RING_CAPACITY - 1)) == 0);
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "the ring is shared between processes");
+
+/*
+Single-producer/single-consumer ring: the helper is the only writer of head, the game the only writer of tail.
+Both sides keep free running indices and only publish them once per batch.
+*/
+struct alignas(64) LinuxInputRing {
+	// written by the game before the helper starts
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	std::atomic<uint32_t> status;
+
+	// helper side
+	alignas(64) std::atomic<uint32_t> head;
+	std::atomic<uint32_t> overflows; // events dropped because the game didn't keep up
+
+	// game side
+	alignas(64) std::atomic<uint32_t> tail;
+
+	alignas(64) LinuxInputEvent events[LINUX_RING_CAPACITY];
+};
+
+// used by the helper to batch events before publishing them
+struct LinuxRingWriter {
+	LinuxInputRing* ring;
+	uint32_t head;
+	uint32_t cachedTail;
+
+	explicit LinuxRingWriter(LinuxInputRing* r)
+		: ring(r), head(r->head.load(std::memory_order_relaxed)), cachedTail(r->tail.load(std::memory_order_acquire)) {}
+
+	bool push(const LinuxInputEvent& event) {
+		if (head - cachedTail == LINUX_RING_CAPACITY) {
+			cachedTail = ring->tail.load(std::memory_order_acquire);
+			if (head - cachedTail == LINUX_RING_CAPACITY) {
+				ring->overflows.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+		}
+
+		ring->events[head & (LINUX_RING_CAPACITY - 1)] = event;
+		head++;
+		return true;
+	}
+
+	void publish() {
+		ring->head.store(head, std::memory_order_release);
+	}
+};
@@ -1,176 +1,233 @@
 #include "includes.hpp"
 
-#include <limits>
-
 #include <Geode/modify/PlayLayer.hpp>
 #include <Geode/modify/GJBaseGameLayer.hpp>
 #include <Geode/modify/PlayerObject.hpp>
 #include <Geode/modify/EndLevelLayer.hpp>
+#include <Geode/modify/PauseLayer.hpp>
 #include <Geode/modify/GJGameLevel.hpp>
 #include <tulip/TulipHook.hpp>
 
-constexpr double SMALLEST_FLOAT = std::numeric_limits<float>::min();
+static_assert(static_cast<int>(InputButton::Jump) == static_cast<int>(PlayerButton::Jump));
+static_assert(static_cast<int>(InputButton::Left) == static_cast<int>(PlayerButton::Left));
+static_assert(static_cast<int>(InputButton::Right) == static_cast<int>(PlayerButton::Right));
 
-constexpr InputEvent EMPTY_INPUT = InputEvent{
-	.time = 0,
-	.inputType = PlayerButton::Jump,
-	.inputState = false,
-	.isPlayer1 = false,
-};
-constexpr Step EMPTY_STEP = Step{
-	.input = EMPTY_INPUT,
-	.deltaFactor = 1.0,
-	.endStep = true,
-};
+InputLanes inputLanes;
 
-std::deque<struct InputEvent> inputQueue;
-std::deque<struct InputEvent> inputQueueCopy;
-std::deque<struct Step> stepQueue;
+StepScheduler scheduler;
+StepCountState stepCountState;
+TraceRecorder traceRecorder;
+Timeline timeline;
+InputGate inputGate;
+const Clock* gameClock = &platformClock();
 
-std::atomic<bool> softToggle;
+StepMetrics attemptMetrics;
+StepMetrics sessionMetrics;
+std::FILE* metricsFile = nullptr;
+int metricsAttempt = 0;
+bool recordMetrics = false;
 
-InputEvent nextInput = EMPTY_INPUT;
+PerfWindow perfWindow;
+bool showPerfHud = false;
 
-TimestampType lastFrameTime;
-TimestampType currentFrameTime;
+std::atomic<bool> softToggle;
 
-bool firstFrame = true;
-bool skipUpdate = true;
 bool enableInput = false;
 bool linuxNative = false;
 bool lateCutoff;
+bool adaptiveCutoff;
+AdaptiveCutoff inputCutoff;
 
-std::array<std::unordered_set<size_t>, 6> inputBinds;
-std::unordered_set<uint16_t> heldInputs;
-
-std::mutex inputQueueLock;
-std::mutex keybindsLock;
+KeyBindings keyBindings;
+HeldInputs heldInputs;
 
 std::atomic<bool> enableRightClick;
 bool threadPriority;
 
-/*
-Original implementation by theyareonit, with critical physics fix applied.
-This function builds a queue of steps based on when inputs occurred.
-*/
-void buildStepQueue(int stepCount) {
-	PlayLayer* playLayer = PlayLayer::get();
-	nextInput = EMPTY_INPUT;
-	stepQueue = {}; // Original: dynamic deallocation
+bool physicsBypass;
+bool legacyBypass;
+bool fixedBypass;
+bool clickOnSteps = false;
 
-	if (lateCutoff) {
-		currentFrameTime = getCurrentTimestamp();
-#ifdef GEODE_IS_WINDOWS
-		if (linuxNative) {
-			linuxCheckInputs();
-		}
-#endif
+void buildStepQueue(int stepCount, float modifiedDelta, float timewarp) {
+	TimelineScope scope(timeline, "buildStepQueue");
 
-		std::lock_guard lock(inputQueueLock);
-		inputQueueCopy = inputQueue;
-		inputQueue = {};
+	// stamped by onFrameStart, the cutoff modes only ever move it later
+	const TimestampType frameStart = scheduler.currentFrameTime;
+	const bool late = lateCutoff && !adaptiveCutoff;
+	TimestampType buildTime = frameStart;
+
+	if (adaptiveCutoff) buildTime = frameStart + applyAdaptiveCutoff(scheduler, inputCutoff);
+	else if (late) {
+		markFrameTime(scheduler);
+		buildTime = scheduler.currentFrameTime;
 	}
-	else {
+	else if (traceRecorder.active()) buildTime = getCurrentTimestamp();
+
 #ifdef GEODE_IS_WINDOWS
-		if (linuxNative) linuxCheckInputs();
+	if (linuxNative) linuxCheckInputs();
 #endif
 
-		std::lock_guard lock(inputQueueLock);
-		while (!inputQueue.empty() && inputQueue.front().time <= currentFrameTime) {
-			inputQueueCopy.push_back(inputQueue.front());
-			inputQueue.pop_front();
-		}
+	const bool firstFrame = scheduler.firstFrame;
+	const TimestampType lastFrameTime = scheduler.lastFrameTime;
+
+	const TimestampType buildStart = showPerfHud ? getCurrentTimestamp() : 0;
+
+	drainInputs(scheduler, inputLanes, late, frameInputLimit(scheduler));
+	if (clickOnSteps) buildTickBuckets(scheduler, stepCount);
+	else buildStepQueue(scheduler, stepCount);
+
+	if (showPerfHud) {
+		const TimestampType buildDuration = getCurrentTimestamp() - buildStart;
+		perfWindow.recordFrame(static_cast<uint64_t>(buildDuration * perfWindow.metrics.nsPerTick), modifiedDelta, stepCountState.predictedDelta);
+	}
+
+	if (traceRecorder.active()) {
+		traceRecorder.recordFrame(TraceFrameRecord{
+			.currentFrameTime = scheduler.currentFrameTime,
+			.lastFrameTime = lastFrameTime,
+			.animationInterval = stepCountState.animationInterval,
+			.modifiedDelta = modifiedDelta,
+			.timewarp = timewarp,
+			.stepCount = stepCount,
+			.flags = (physicsBypass ? TracePhysicsBypass : 0u)
+				| (legacyBypass ? TraceLegacyBypass : 0u)
+				| (fixedBypass ? TraceFixedBypass : 0u)
+				| (late ? TraceLateCutoff : 0u)
+				| (adaptiveCutoff ? TraceAdaptiveCutoff : 0u)
+				| (firstFrame ? TraceFirstFrame : 0u)
+				| (clickOnSteps ? TraceClickOnSteps : 0u),
+			.frameStartTime = frameStart,
+			.buildTime = buildTime
+		});
 	}
+}
 
-	skipUpdate = false;
-	if (firstFrame) {
-		skipUpdate = true;
-		firstFrame = false;
-		lastFrameTime = currentFrameTime;
-		if (!lateCutoff) inputQueueCopy = {};
+void toggleTimelineCapture(bool enable) {
+	if (!enable) {
+		timeline.stop();
+		log::info("Timeline capture stopped, {} events dropped", timeline.dropped());
 		return;
 	}
 
-	TimestampType deltaTime = currentFrameTime - lastFrameTime;
-	TimestampType stepDelta = (deltaTime / stepCount) + 1;
-
-	for (int i = 0; i < stepCount; i++) {
-		double elapsedTime = 0.0;
-		while (!inputQueueCopy.empty()) {
-			InputEvent front = inputQueueCopy.front();
+	auto path = Mod::get()->getSaveDir() / "timelines" / fmt::format("{}.json", std::time(nullptr));
+	timeline.start(path);
+	log::info("Capturing timeline to {}", path.string());
+}
 
-			if (front.time - lastFrameTime < stepDelta * (i + 1)) {
-				double inputTime = static_cast<double>((front.time - lastFrameTime) % stepDelta) / stepDelta;
-				stepQueue.emplace_back(Step{ front, std::clamp(inputTime - elapsedTime, SMALLEST_FLOAT, 1.0), false });
-				inputQueueCopy.pop_front();
-				elapsedTime = inputTime;
-			}
-			else break;
-		}
+void toggleTraceRecording(bool enable) {
+	if (!enable) {
+		traceRecorder.stop();
+		return;
+	}
 
-		stepQueue.emplace_back(Step{ EMPTY_INPUT, std::max(SMALLEST_FLOAT, 1.0 - elapsedTime), true });
+	auto path = Mod::get()->getSaveDir() / "traces" / fmt::format("{}.cbftrace", std::time(nullptr));
+	if (traceRecorder.start(path, getTimestampFrequency())) {
+		log::info("Recording input trace to {}", path.string());
 	}
+	else {
+		log::error("Failed to create input trace {}", path.string());
+	}
+}
 
-	lastFrameTime = currentFrameTime;
+// the scheduler records into the HUD's window while it's shown, which then gets folded into the attempt
+void updateMetricsSink() {
+	if (showPerfHud) scheduler.metrics = &perfWindow.metrics;
+	else scheduler.metrics = recordMetrics ? &attemptMetrics : nullptr;
 }
 
-/*
-Original implementation - unchanged
-*/
-Step popStepQueue() {
-	if (stepQueue.empty()) return EMPTY_STEP;
+void finishMetricsAttempt() {
+	if (showPerfHud && recordMetrics) {
+		attemptMetrics.merge(perfWindow.metrics);
+		perfWindow.metrics.clear();
+	}
+	if (!recordMetrics || !attemptMetrics.substeps.count()) return;
+
+	if (!metricsFile) {
+		auto path = Mod::get()->getSaveDir() / "metrics" / fmt::format("{}.txt", std::time(nullptr));
+		std::error_code ec;
+		std::filesystem::create_directories(path.parent_path(), ec);
+#ifdef GEODE_IS_WINDOWS
+		metricsFile = _wfopen(path.c_str(), L"w");
+#else
+		metricsFile = std::fopen(path.c_str(), "w");
+#endif
+		if (!metricsFile) {
+			log::error("Failed to create metrics file {}", path.string());
+			return;
+		}
+		log::info("Writing input metrics to {}", path.string());
+	}
 
-	Step front = stepQueue.front();
-	double deltaFactor = front.deltaFactor;
+	writeMetricsSummary(metricsFile, fmt::format("attempt {}", ++metricsAttempt).c_str(), attemptMetrics);
+	sessionMetrics.merge(attemptMetrics);
+	attemptMetrics.clear();
+}
 
-	if (nextInput.time != 0) {
-		PlayLayer* playLayer = PlayLayer::get();
+// a session lasts until the level is left, every attempt in it gets its own block and the totals go at the end
+void finishMetricsSession() {
+	finishMetricsAttempt();
 
-		enableInput = true;
-		playLayer->handleButton(nextInput.inputState, (int)nextInput.inputType, nextInput.isPlayer1);
-		enableInput = false;
+	if (metricsFile) {
+		writeMetricsSummary(metricsFile, "session", sessionMetrics);
+		std::fclose(metricsFile);
+		metricsFile = nullptr;
+	}
+	sessionMetrics.clear();
+	metricsAttempt = 0;
+}
+
+void toggleMetrics(bool enable) {
+	if (!enable) {
+		finishMetricsSession();
+		recordMetrics = false;
+		updateMetricsSink();
+		return;
 	}
 
-	nextInput = front.input;
-	stepQueue.pop_front();
+	attemptMetrics.clear();
+	attemptMetrics.nsPerTick = 1e9 / static_cast<double>(getTimestampFrequency());
+	recordMetrics = true;
+	updateMetricsSink();
+}
 
-	return front;
+void setCoalesceWindow(int64_t us) {
+	scheduler.coalesceTicks = static_cast<TimestampType>(us * getTimestampFrequency() / 1'000'000);
+}
+
+void setCutoffErrorBound(int64_t us) {
+	inputCutoff.setErrorBound(static_cast<TimestampType>(us * getTimestampFrequency() / 1'000'000));
 }
 
 #ifdef GEODE_IS_WINDOWS
 #include <geode.custom-keybinds/include/Keybinds.hpp>
 
-/*
-Original implementation - unchanged
-*/
 void updateKeybinds() {
-	std::array<std::unordered_set<size_t>, 6> binds;
+	KeyBindings::Binds binds;
 	std::vector<geode::Ref<keybinds::Bind>> v;
 
 	enableRightClick.store(Mod::get()->getSettingValue<bool>("right-click"));
 
 	v = keybinds::BindManager::get()->getBindsFor("robtop.geometry-dash/jump-p1");
-	for (int i = 0; i < v.size(); i++) binds[p1Jump].emplace(v[i]->getHash());
+	for (int i = 0; i < v.size(); i++) binds[p1Jump].push_back(v[i]->getHash());
 
 	v = keybinds::BindManager::get()->getBindsFor("robtop.geometry-dash/move-left-p1");
-	for (int i = 0; i < v.size(); i++) binds[p1Left].emplace(v[i]->getHash());
+	for (int i = 0; i < v.size(); i++) binds[p1Left].push_back(v[i]->getHash());
 
 	v = keybinds::BindManager::get()->getBindsFor("robtop.geometry-dash/move-right-p1");
-	for (int i = 0; i < v.size(); i++) binds[p1Right].emplace(v[i]->getHash());
+	for (int i = 0; i < v.size(); i++) binds[p1Right].push_back(v[i]->getHash());
 
 	v = keybinds::BindManager::get()->getBindsFor("robtop.geometry-dash/jump-p2");
-	for (int i = 0; i < v.size(); i++) binds[p2Jump].emplace(v[i]->getHash());
+	for (int i = 0; i < v.size(); i++) binds[p2Jump].push_back(v[i]->getHash());
 
 	v = keybinds::BindManager::get()->getBindsFor("robtop.geometry-dash/move-left-p2");
-	for (int i = 0; i < v.size(); i++) binds[p2Left].emplace(v[i]->getHash());
+	for (int i = 0; i < v.size(); i++) binds[p2Left].push_back(v[i]->getHash());
 
 	v = keybinds::BindManager::get()->getBindsFor("robtop.geometry-dash/move-right-p2");
-	for (int i = 0; i < v.size(); i++) binds[p2Right].emplace(v[i]->getHash());
+	for (int i = 0; i < v.size(); i++) binds[p2Right].push_back(v[i]->getHash());
 
-	{
-		std::lock_guard lock(keybindsLock);
-		inputBinds = binds;
-	}
+	// only rebuilds the lookup table if the binds changed since the last level
+	keyBindings.update(std::move(binds));
 }
 #endif
 
@@ -188,58 +245,167 @@ void decomp_resetCollisionLog(PlayerObject* p) {
 	p->m_lastCollisionTop = -1;
 }
 
-double averageDelta = 0.0;
+EmaPredictor emaPredictor;
+MedianPredictor medianPredictor;
+PercentilePredictor percentilePredictor;
 
-bool physicsBypass;
-bool legacyBypass;
+// null keeps the built-in averageDelta, which behaves exactly like emaPredictor
+void setBypassPredictor(std::string name) {
+	FramePredictor* predictor = nullptr;
+	if (name == "median") predictor = &medianPredictor;
+	else if (name == "percentile") predictor = &percentilePredictor;
+
+	if (predictor) predictor->reset();
+	stepCountState.predictor = predictor;
+}
+
+// picked by the physics bypass settings, calculateStepCount switches on it once per frame with the strategy inlined
+StepCountMode stepCountMode = StepCountMode::Vanilla;
+
+void updateStepCountMode() {
+	stepCountMode = selectStepCountMode(physicsBypass, legacyBypass, fixedBypass);
+	stepCountState.tickAccumulator = 0.0;
+}
+
+void setBypassMode(std::string mode) {
+	legacyBypass = mode == "2.1";
+	fixedBypass = mode == "fixed";
+	updateStepCountMode();
+}
 
 /*
-Original implementation - unchanged
+The frame rate can only be changed from the settings, which are out of reach while the input gate is open,
+so onFrameStart refreshes the interval while it's closed and playing frames don't touch the director.
 */
-int calculateStepCount(float delta, float timewarp, bool forceVanilla) {
-	// Vanilla 2.2 formula
-	if (!physicsBypass || forceVanilla) {
-		return static_cast<int>(std::round(std::max(1.0, ((delta * 60.0) / std::min(1.0f, timewarp)) * 4.0)));
+void refreshAnimationInterval() {
+	static CCDirector* director = CCDirector::sharedDirector();
+	stepCountState.animationInterval = director->getAnimationInterval();
+}
+
+int calculateStepCount(float delta, float timewarp) {
+	return calculateStepCount(stepCountMode, stepCountState, delta, timewarp);
+}
+
+bool safeMode;
+
+/*
+Invisible child that opens or closes the input gate as its parent enters and leaves the running scene,
+so pausing, resuming, the end screen and leaving the level are all seen without scanning children every frame.
+*/
+class GateNode : public CCNode {
+public:
+	static GateNode* create(GateReason reason, bool closesGate) {
+		auto node = new GateNode();
+		node->m_reason = reason;
+		node->m_closesGate = closesGate;
+		node->setID("input-gate"_spr);
+		node->autorelease();
+		return node;
 	}
 
-	// Legacy 2.1 physics bypass
-	if (legacyBypass) {
-		return static_cast<int>(std::round(std::max(4.0, delta * 240.0) / std::min(1.0f, timewarp)));
+	void onEnter() override {
+		CCNode::onEnter();
+		inputGate.set(m_reason, m_closesGate);
 	}
 
-	// Modern 2.2 physics bypass with lag compensation
-	const double animationInterval = CCDirector::sharedDirector()->getAnimationInterval();
+	void onExit() override {
+		inputGate.set(m_reason, !m_closesGate);
+		CCNode::onExit();
+	}
 
-	// Exponential moving average with saturation protection
-	averageDelta = (EMA_ALPHA * delta) + ((1.0 - EMA_ALPHA) * averageDelta);
-	averageDelta = std::min(averageDelta, animationInterval * EMA_MAX_RATIO);
+private:
+	GateReason m_reason = GateNoLevel;
+	bool m_closesGate = true;
+};
 
-	const bool laggingOneFrame = animationInterval < delta - (1.0 / 240.0);
-	const bool laggingSustained = averageDelta - animationInterval > LAG_THRESHOLD;
+constexpr float PERF_HUD_INTERVAL = 0.5f;
 
-	// No step variance when running smoothly
-	if (!laggingOneFrame && !laggingSustained) {
-		return static_cast<int>(std::round(std::ceil((animationInterval * 240.0) - STEP_EPSILON) / std::min(1.0f, timewarp)));
-		}
-	// Sustained low fps
-		else if (!laggingOneFrame) {
-		return static_cast<int>(std::round(std::ceil(averageDelta * 240.0) / std::min(1.0f, timewarp)));
+/*
+Live numbers from perfWindow, in the same faint bigFont as the end screen indicator.
+The label is only rebuilt on a cocos schedule every PERF_HUD_INTERVAL seconds, never from the frame hooks.
+*/
+class PerfHud : public CCNode {
+public:
+	static PerfHud* create() {
+		auto node = new PerfHud();
+		if (!node->init()) {
+			delete node;
+			return nullptr;
 		}
-	// Single frame spike - catch up
-		else {
-		return static_cast<int>(std::round(std::ceil(delta * 240.0) / std::min(1.0f, timewarp)));
+		node->autorelease();
+		return node;
 	}
-}
 
-bool safeMode;
+	bool init() override {
+		if (!CCNode::init()) return false;
+
+		cocos2d::CCSize size = cocos2d::CCDirector::sharedDirector()->getWinSize();
+		m_label = CCLabelBMFont::create("", "bigFont.fnt");
+		m_label->setPosition({ 4.0f, size.height - 4.0f });
+		m_label->setAnchorPoint({ 0.0f, 1.0f });
+		m_label->setOpacity(90);
+		m_label->setScale(0.25f);
+		this->addChild(m_label);
+
+		this->setID("perf-hud"_spr);
+		this->schedule(schedule_selector(PerfHud::refresh), PERF_HUD_INTERVAL);
+		return true;
+	}
+
+	void refresh(float) {
+		if (recordMetrics) attemptMetrics.merge(perfWindow.metrics);
+
+		const PerfSnapshot snapshot = perfWindow.take();
+		if (!snapshot.frames) return; // paused or not scheduling, keep the last numbers up
+
+		m_label->setString(formatPerfSnapshot(snapshot, physicsBypass && !legacyBypass && !fixedBypass).c_str());
+	}
+
+private:
+	CCLabelBMFont* m_label = nullptr;
+};
+
+void togglePerfHud(bool enable) {
+	PlayLayer* pl = PlayLayer::get();
+
+	if (!enable) {
+		if (pl) pl->removeChildByID("perf-hud"_spr);
+		if (recordMetrics) attemptMetrics.merge(perfWindow.metrics);
+		showPerfHud = false;
+		updateMetricsSink();
+		return;
+	}
+
+	if (showPerfHud) return;
+	perfWindow.clear();
+	perfWindow.metrics.nsPerTick = 1e9 / static_cast<double>(getTimestampFrequency());
+	showPerfHud = true;
+	updateMetricsSink();
+
+	if (pl) pl->addChild(PerfHud::create(), 1000);
+}
 
 class $modify(PlayLayer) {
-#ifdef GEODE_IS_WINDOWS
 	bool init(GJGameLevel * level, bool useReplay, bool dontCreateObjects) {
+#ifdef GEODE_IS_WINDOWS
 		updateKeybinds();
-		return PlayLayer::init(level, useReplay, dontCreateObjects);
-	}
 #endif
+		if (!PlayLayer::init(level, useReplay, dontCreateObjects)) return false;
+
+		this->addChild(GateNode::create(GateNoLevel, false));
+		if (showPerfHud) this->addChild(PerfHud::create(), 1000);
+		return true;
+	}
+
+	void resetLevel() {
+		finishMetricsAttempt();
+		PlayLayer::resetLevel();
+	}
+
+	void onQuit() {
+		finishMetricsSession();
+		PlayLayer::onQuit();
+	}
 
 	void levelComplete() {
 		const bool testMode = this->m_isTestMode;
@@ -262,35 +428,20 @@ class $modify(PlayLayer) {
 bool mouseFix;
 
 void onFrameStart() {
-	PlayLayer* playLayer = PlayLayer::get();
-	CCNode* par;
+	TimelineScope scope(timeline, "onFrameStart");
 
-	if (!lateCutoff) {
-		currentFrameTime = getCurrentTimestamp();
-	}
+	// late and adaptive cutoff move this forward in buildStepQueue, and need to know where the frame started to do it
+	markFrameTime(scheduler);
 
-	const bool shouldDisable = softToggle.load(std::memory_order_relaxed)
-#ifdef GEODE_IS_WINDOWS
-		|| !GetFocus()
-#endif
-		|| !playLayer
-		|| !(par = playLayer->getParent())
-		|| (par->getChildByType<PauseLayer>(0))
-		|| (playLayer->getChildByType<EndLevelLayer>(0)))
-	{
-		firstFrame = true;
-		skipUpdate = true;
+	if (!inputGate.open()) {
+		resetStepScheduler(scheduler);
+		refreshAnimationInterval();
 		enableInput = true;
 
-		inputQueueCopy = {};
-
-		if (!linuxNative) {
-			std::lock_guard lock(inputQueueLock);
-			inputQueue = {};
-		}
+		if (!linuxNative) inputLanes.clear();
 	}
 #ifdef GEODE_IS_WINDOWS
-	if (mouseFix && !skipUpdate) {
+	if (mouseFix && !scheduler.skipUpdate) {
 		MSG msg;
 		int index = 0;
 		while (PeekMessage(&msg, NULL, WM_MOUSEFIRST + index, WM_MOUSELAST, PM_NOREMOVE)) {
@@ -324,7 +475,6 @@ class $modify(CCScheduler) {
 #endif
 
 int stepCount;
-bool clickOnSteps = false;
 
 class $modify(GJBaseGameLayer) {
 	static void onModify(auto& self) {
@@ -340,27 +490,33 @@ class $modify(GJBaseGameLayer) {
 		PlayLayer* pl = PlayLayer::get();
 		if (pl) {
 			const float timewarp = pl->m_gameState.m_timeWarp;
-			if (physicsBypass && (!firstFrame || softToggle.load())) modifiedDelta = CCDirector::sharedDirector()->getActualDeltaTime() * timewarp;
+			if (physicsBypass && (!scheduler.firstFrame || softToggle.load())) modifiedDelta = CCDirector::sharedDirector()->getActualDeltaTime() * timewarp;
 
-			stepCount = calculateStepCount(modifiedDelta, timewarp, false);
+			stepCount = calculateStepCount(modifiedDelta, timewarp);
 
 			if (pl->m_playerDied || GameManager::sharedState()->getEditorLayer() || softToggle.load()) {
 				enableInput = true;
-				skipUpdate = true;
-				firstFrame = true;
+				scheduler.skipUpdate = true;
+				scheduler.firstFrame = true;
 			}
-			else if (modifiedDelta > 0.0) buildStepQueue(stepCount);
-			else skipUpdate = true;
+			else if (modifiedDelta > 0.0) buildStepQueue(stepCount, modifiedDelta, timewarp);
+			else scheduler.skipUpdate = true;
 		}
-		else if (physicsBypass) stepCount = calculateStepCount(modifiedDelta, this->m_gameState.m_timeWarp, true);
+		else if (physicsBypass) stepCount = StepCountStrategy<StepCountMode::Vanilla>::calculate(stepCountState, modifiedDelta, this->m_gameState.m_timeWarp);
 
 		return modifiedDelta;
 	}
 
 	void processCommands(float p0) {
-		if (clickOnSteps && !stepQueue.empty()) {
-			Step step;
-			do step = popStepQueue(); while (!stepQueue.empty() && !step.endStep);
+		TimelineScope scope(timeline, "processCommands");
+
+		if (clickOnSteps) {
+			dispatchTick(scheduler, [](const InputEvent* inputs, size_t count) {
+				PlayLayer* pl = PlayLayer::get();
+				enableInput = true;
+				for (size_t i = 0; i < count; i++) pl->handleButton(inputs[i].inputState, static_cast<int>(inputs[i].inputType), inputs[i].isPlayer1);
+				enableInput = false;
+			});
 		}
 		GJBaseGameLayer::processCommands(p0);
 	}
@@ -384,12 +540,67 @@ class $modify(GJBaseGameLayer) {
 CCPoint p1Pos = { 0.f, 0.f };
 CCPoint p2Pos = { 0.f, 0.f };
 
-float rotationDelta;
 float shipRotDelta = 0.0f;
 bool inputThisStep = false;
-bool p1Split = false;
-bool p2Split = false;
-bool midStep = false;
+SplitStepState split;
+
+/*
+A PlayerObject for SplitStep. The player whose update hook is running calls the originals directly,
+the other one goes through the hooks like before, which pass straight through while split.midStep is set.
+*/
+template <bool Hooked>
+struct GameSplitPlayer {
+	PlayerObject* player;
+	PlayLayer* layer;
+
+	bool onGround() const {
+		return player->m_isOnGround;
+	}
+
+	void setOnGround(bool onGround) {
+		player->m_isOnGround = onGround;
+	}
+
+	bool notBuffering() const {
+		return player->m_isOnGround
+			|| player->m_touchingRings->count()
+			|| player->m_isDashing
+			|| (player->m_isDart || player->m_isBird || player->m_isShip || player->m_isSwing);
+	}
+
+	bool fallingTowardGround() const {
+		return (player->m_yVelocity < 0) ^ player->m_isUpsideDown;
+	}
+
+	void update(float delta) {
+		if constexpr (Hooked) player->PlayerObject::update(delta);
+		else player->update(delta);
+	}
+
+	void updateRotation(float delta) {
+		if constexpr (Hooked) player->PlayerObject::updateRotation(delta);
+		else player->updateRotation(delta);
+	}
+
+	void checkCollisions(float delta) {
+		layer->checkCollisions(player, delta, true);
+	}
+
+	bool collisionLogClean() const {
+		return !player->m_collisionLogTop->count()
+			&& !player->m_collisionLogBottom->count()
+			&& !player->m_collisionLogLeft->count()
+			&& !player->m_collisionLogRight->count()
+			&& player->m_lastCollisionLeft == -1
+			&& player->m_lastCollisionRight == -1
+			&& player->m_lastCollisionBottom == -1
+			&& player->m_lastCollisionTop == -1;
+	}
+
+	void resetCollisionLog() {
+		decomp_resetCollisionLog(player);
+	}
+};
 
 class $modify(PlayerObject) {
 	/*
@@ -400,105 +611,60 @@ class $modify(PlayerObject) {
 
 	This fix maintains the original architecture (splitting position updates into substeps)
 	but corrects the collision detection to use stepDelta like vanilla does.
+	The loop itself is SplitStep in core/splitstep.hpp.
 	*/
 	void update(float stepDelta) {
 		PlayLayer* pl = PlayLayer::get();
-		if (!skipUpdate) enableInput = false;
+		if (!scheduler.skipUpdate) enableInput = false;
 
-		if (pl && this != pl->m_player1 || midStep) {
-			if (midStep || !inputThisStep || this != pl->m_player2) PlayerObject::update(stepDelta);
+		if (pl && this != pl->m_player1 || split.midStep) {
+			if (split.midStep || !inputThisStep || this != pl->m_player2) PlayerObject::update(stepDelta);
 			return;
 		}
 
-		inputThisStep = stepQueue.empty() ? false : !stepQueue.front().endStep;
-		if (!stepQueue.empty() && !inputThisStep && !clickOnSteps) stepQueue.pop_front();
+		// Click on Steps frames have no plan, processCommands hands out their inputs
+		if (!clickOnSteps) {
+			const bool stepPlanned = hasNextStep(scheduler);
+			inputThisStep = stepPlanned && !scheduler.stepQueue.front().endStep;
+			if (stepPlanned && !inputThisStep) scheduler.stepQueue.pop_front();
+		}
 
-		if (skipUpdate
+		if (scheduler.skipUpdate
 			|| !pl
 			|| !inputThisStep
 			|| clickOnSteps)
 		{
-			p1Split = false;
-			p2Split = false;
+			split.p1Split = false;
+			split.p2Split = false;
 			inputThisStep = false;
 			PlayerObject::update(stepDelta);
 			return;
 		}
 
 		PlayerObject* p2 = pl->m_player2;
-		bool isDual = pl->m_gameState.m_isDualMode;
-		bool p1StartedOnGround = this->m_isOnGround;
-		bool p2StartedOnGround = p2->m_isOnGround;
-
-		bool p1NotBuffering = p1StartedOnGround
-			|| this->m_touchingRings->count()
-			|| this->m_isDashing
-			|| (this->m_isDart || this->m_isBird || this->m_isShip || this->m_isSwing);
-
-		bool p2NotBuffering = p2StartedOnGround
-			|| p2->m_touchingRings->count()
-			|| p2->m_isDashing
-			|| (p2->m_isDart || p2->m_isBird || p2->m_isShip || p2->m_isSwing);
-
 		p1Pos = PlayerObject::getPosition();
 		p2Pos = p2->getPosition();
 
-		p1Split = p1NotBuffering;
-		p2Split = p2NotBuffering && isDual;
-
-		Step step;
-		bool firstLoop = true;
-		midStep = true;
-
-		do {
-			step = popStepQueue();
-			const float substepDelta = stepDelta * step.deltaFactor;
-			rotationDelta = substepDelta;
-
-			if (p1Split) {
-				PlayerObject::update(substepDelta);
-				if (!step.endStep) {
-					if (firstLoop && ((this->m_yVelocity < 0) ^ this->m_isUpsideDown)) this->m_isOnGround = p1StartedOnGround;
-
-					// CRITICAL FIX: Always use stepDelta for collision detection (matches vanilla)
-					// Original code used 0.0f or substepDelta here, which was wrong
-					pl->checkCollisions(this, stepDelta, true);
-
-					PlayerObject::updateRotation(substepDelta);
-					decomp_resetCollisionLog(this);
-				}
-			}
-			else if (step.endStep) PlayerObject::update(stepDelta);
-
-			if (p2Split) {
-				p2->update(substepDelta);
-				if (!step.endStep) {
-					if (firstLoop && ((p2->m_yVelocity < 0) ^ p2->m_isUpsideDown)) p2->m_isOnGround = p2StartedOnGround;
-
-					// CRITICAL FIX: Same for player 2
-					pl->checkCollisions(p2, stepDelta, true);
+		GameSplitPlayer<true> player1{ this, pl };
+		GameSplitPlayer<false> player2{ p2, pl };
+		auto dispatch = [pl](const InputEvent& input) {
+			enableInput = true;
+			pl->handleButton(input.inputState, static_cast<int>(input.inputType), input.isPlayer1);
+			enableInput = false;
+		};
 
-					p2->updateRotation(substepDelta);
-					decomp_resetCollisionLog(p2);
-				}
-			}
-			else if (step.endStep) p2->update(stepDelta);
-
-			firstLoop = false;
-		} while (!step.endStep);
-
-		midStep = false;
+		SplitStep(scheduler, timeline, split, player1, player2, dispatch).run(stepDelta, pl->m_gameState.m_isDualMode);
 	}
 
 	void updateRotation(float t) {
 		PlayLayer* pl = PlayLayer::get();
 
-		if (pl && this == pl->m_player1 && p1Split && !midStep) {
-			PlayerObject::updateRotation(rotationDelta);
+		if (pl && this == pl->m_player1 && split.p1Split && !split.midStep) {
+			PlayerObject::updateRotation(split.rotationDelta);
 			this->m_lastPosition = p1Pos;
 		}
-		else if (pl && this == pl->m_player2 && p2Split && !midStep) {
-			PlayerObject::updateRotation(rotationDelta);
+		else if (pl && this == pl->m_player2 && split.p2Split && !split.midStep) {
+			PlayerObject::updateRotation(split.rotationDelta);
 			this->m_lastPosition = p2Pos;
 		}
 		else {
@@ -506,7 +672,7 @@ class $modify(PlayerObject) {
 		}
 
 		// Fix percent calculation with physics bypass
-		if (physicsBypass && pl && !midStep) {
+		if (physicsBypass && pl && !split.midStep) {
 			pl->m_gameState.m_currentProgress = static_cast<int>(pl->m_gameState.m_levelTime * 240.0);
 		}
 	}
@@ -528,9 +694,17 @@ class $modify(PlayerObject) {
 #endif
 };
 
+class $modify(PauseLayer) {
+	void customSetup() {
+		PauseLayer::customSetup();
+		this->addChild(GateNode::create(GatePaused, true));
+	}
+};
+
 class $modify(EndLevelLayer) {
 	void customSetup() {
 		EndLevelLayer::customSetup();
+		this->addChild(GateNode::create(GateLevelEnded, true));
 
 		if (!softToggle.load(std::memory_order_relaxed) || physicsBypass) {
 			std::string text;
@@ -609,6 +783,7 @@ void togglePhysicsBypass(bool enable) {
 
 	physicsBypass = enable;
 #endif
+	updateStepCountMode();
 }
 
 void toggleMod(bool disable) {
@@ -629,22 +804,37 @@ void toggleMod(bool disable) {
 #endif
 
 	softToggle.store(disable, std::memory_order_relaxed);
+	inputGate.set(GateDisabled, disable);
 }
 
 $on_mod(Loaded) {
 	Mod::get()->setSavedValue<bool>("is-linux", false);
 
+#ifdef GEODE_IS_WINDOWS
+	// before any setting callback, the clock's frequency depends on it
+	detectLinuxNative();
+#endif
+
+	scheduler.clock = gameClock;
+
 	toggleMod(Mod::get()->getSettingValue<bool>("soft-toggle"));
 	listenForSettingChanges("soft-toggle", toggleMod);
 
 	togglePhysicsBypass(Mod::get()->getSettingValue<bool>("physics-bypass"));
 	listenForSettingChanges("physics-bypass", togglePhysicsBypass);
 
-	legacyBypass = Mod::get()->getSettingValue<std::string>("bypass-mode") == "2.1";
-	listenForSettingChanges("bypass-mode", +[](std::string mode) {
-		legacyBypass = mode == "2.1";
+	setBypassPredictor(Mod::get()->getSettingValue<std::string>("bypass-predictor"));
+	listenForSettingChanges("bypass-predictor", setBypassPredictor);
+
+	stepCountState.fixedTps = static_cast<int>(Mod::get()->getSettingValue<int64_t>("fixed-tps"));
+	listenForSettingChanges("fixed-tps", +[](int64_t tps) {
+		stepCountState.fixedTps = static_cast<int>(tps);
+		stepCountState.tickAccumulator = 0.0;
 		});
 
+	setBypassMode(Mod::get()->getSettingValue<std::string>("bypass-mode"));
+	listenForSettingChanges("bypass-mode", setBypassMode);
+
 	safeMode = Mod::get()->getSettingValue<bool>("safe-mode");
 	listenForSettingChanges("safe-mode", +[](bool enable) {
 		safeMode = enable;
@@ -655,6 +845,9 @@ $on_mod(Loaded) {
 		clickOnSteps = enable;
 		});
 
+	setCoalesceWindow(Mod::get()->getSettingValue<int64_t>("coalesce-inputs"));
+	listenForSettingChanges("coalesce-inputs", setCoalesceWindow);
+
 	mouseFix = Mod::get()->getSettingValue<bool>("mouse-fix");
 	listenForSettingChanges("mouse-fix", +[](bool enable) {
 		mouseFix = enable;
@@ -665,8 +858,31 @@ $on_mod(Loaded) {
 		lateCutoff = enable;
 		});
 
+	setCutoffErrorBound(Mod::get()->getSettingValue<int64_t>("cutoff-error-bound"));
+	listenForSettingChanges("cutoff-error-bound", setCutoffErrorBound);
+
+	adaptiveCutoff = Mod::get()->getSettingValue<bool>("adaptive-cutoff");
+	listenForSettingChanges("adaptive-cutoff", +[](bool enable) {
+		inputCutoff.reset();
+		adaptiveCutoff = enable;
+		});
+
 	threadPriority = Mod::get()->getSettingValue<bool>("thread-priority");
 
+	scheduler.recorder = &traceRecorder;
+	toggleTraceRecording(Mod::get()->getSettingValue<bool>("record-trace"));
+	listenForSettingChanges("record-trace", toggleTraceRecording);
+
+	Timeline::nameThread("main");
+	toggleTimelineCapture(Mod::get()->getSettingValue<bool>("capture-timeline"));
+	listenForSettingChanges("capture-timeline", toggleTimelineCapture);
+
+	toggleMetrics(Mod::get()->getSettingValue<bool>("record-metrics"));
+	listenForSettingChanges("record-metrics", toggleMetrics);
+
+	togglePerfHud(Mod::get()->getSettingValue<bool>("perf-hud"));
+	listenForSettingChanges("perf-hud", togglePerfHud);
+
 #ifdef GEODE_IS_WINDOWS
 	(void) Mod::get()->hook(
 		reinterpret_cast<void*>(geode::base::get() + 0x71ec0),
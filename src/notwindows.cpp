@@ -8,14 +8,14 @@ class $modify(GJBaseGameLayer) {
 		if (!softToggle.load() && pendingInputTimestamp) {
 			InputEvent ev{
 				.time = pendingInputTimestamp,
-				.inputType = PlayerButton(button),
+				.inputType = InputButton(button),
 				.inputState = push ? State::Press : State::Release,
 				.isPlayer1 = !isPlayer2
 			};
 
-			if (!inputQueue.push(ev)) {
-				// Fallback to slower method if queue is full
-				log::warn("Input queue full in queueButton");
+			timeline.instant("queueButton");
+			if (!inputLanes.push(RawInputLane, ev)) {
+				log::warn("Input lane full in queueButton");
 			}
 		}
 
@@ -1,25 +1,46 @@
 #include "includes.hpp"
 #include <geode.custom-keybinds/include/Keybinds.hpp>
 
-TimestampType getCurrentTimestamp() {
-	LARGE_INTEGER t;
-	if (linuxNative) {
-		// used instead of QPC to make it possible to convert between Linux and Windows timestamps
-		GetSystemTimePreciseAsFileTime((FILETIME*)&t);
+class WindowsClock : public Clock {
+public:
+	WindowsClock() {
+		LARGE_INTEGER f;
+		QueryPerformanceFrequency(&f);
+		m_qpcFrequency = f.QuadPart;
 	}
-	else {
-		QueryPerformanceCounter(&t);
+
+	TimestampType now() const override {
+		LARGE_INTEGER t;
+		if (linuxNative) {
+			// used instead of QPC to make it possible to convert between Linux and Windows timestamps
+			GetSystemTimePreciseAsFileTime((FILETIME*)&t);
+		}
+		else {
+			QueryPerformanceCounter(&t);
+		}
+		return t.QuadPart;
+	}
+
+	TimestampType frequency() const override {
+		if (linuxNative) return 10'000'000; // FILETIME is in 100ns units
+		return m_qpcFrequency;
 	}
-	return t.QuadPart;
+
+private:
+	TimestampType m_qpcFrequency;
+};
+
+const Clock& platformClock() {
+	static const WindowsClock clock;
+	return clock;
 }
 
-LPVOID pBuf;
 HANDLE hSharedMem = NULL;
-HANDLE hMutex = NULL;
+LinuxInputRing* linuxInputRing = nullptr;
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 	LARGE_INTEGER time;
-	PlayerButton inputType;
+	InputButton inputType;
 	bool inputState;
 	bool player1;
 
@@ -49,30 +70,16 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 			if (vkey >= VK_NUMPAD0 && vkey <= VK_NUMPAD9) vkey -= 0x30; // make numpad numbers work with customkeybinds
 
 			// cocos2d::enumKeyCodes corresponds directly to vkeys
-			if (heldInputs.contains(vkey)) {
-				if (inputState) return 0;
-				else heldInputs.erase(vkey);
+			// held keys keep sending presses, only the first one counts
+			if (inputState) {
+				if (!heldInputs.press(vkey)) return 0;
 			}
-
-			bool shouldEmplace = true;
-			player1 = true;
-
-			{
-				std::lock_guard lock(keybindsLock);
-
-				if (inputBinds[p1Jump].contains(vkey)) inputType = PlayerButton::Jump;
-				else if (inputBinds[p1Left].contains(vkey)) inputType = PlayerButton::Left;
-				else if (inputBinds[p1Right].contains(vkey)) inputType = PlayerButton::Right;
-				else {
-					player1 = false;
-					if (inputBinds[p2Jump].contains(vkey)) inputType = PlayerButton::Jump;
-					else if (inputBinds[p2Left].contains(vkey)) inputType = PlayerButton::Left;
-					else if (inputBinds[p2Right].contains(vkey)) inputType = PlayerButton::Right;
-					else shouldEmplace = false;
-				}
+			else {
+				heldInputs.release(vkey);
 			}
 
-			if (inputState) heldInputs.emplace(vkey);
+			bool shouldEmplace = keyBindings.lookup(vkey, inputType, player1);
+
 			if (!shouldEmplace) return 0;
 
 			break;
@@ -82,7 +89,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 			bool shouldEmplace = true;
 
 			player1 = true;
-			inputType = PlayerButton::Jump;
+			inputType = InputButton::Jump;
 
 			if (flags & RI_MOUSE_BUTTON_1_DOWN) inputState = Press;
 			else if (flags & RI_MOUSE_BUTTON_1_UP) inputState = Release;
@@ -108,15 +115,17 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		return DefWindowProcA(hwnd, uMsg, wParam, lParam);
 	}
 
-	{
-		std::lock_guard lock(inputQueueLock);
-		inputQueue.emplace_back(InputEvent{ timestampFromLarge(time), inputType, inputState, player1 });
+	timeline.instant("raw input");
+	if (!inputLanes.push(RawInputLane, InputEvent{ timestampFromLarge(time), inputType, inputState, player1 })) {
+		log::warn("Raw input lane full");
 	}
 
 	return 0;
 }
 
 void rawInputThread() {
+	Timeline::nameThread("raw input");
+
 	WNDCLASS wc = {};
 	wc.lpfnWndProc = WindowProc;
 	wc.hInstance = GetModuleHandleA(NULL);
@@ -159,6 +168,8 @@ void rawInputThread() {
 }
 
 void xinputThread() {
+	Timeline::nameThread("xinput");
+
 	const HMODULE xinputLib = LoadLibrary("Xinput1_4.dll");
 	if (xinputLib == NULL) {
 		log::error("Failed to load Xinput1_4.dll");
@@ -261,38 +272,23 @@ void xinputThread() {
 				}
 
 				if (buttonPressed) {
-					if (heldInputs.contains(ccButton)) continue; // skip if already held
-					heldInputs.emplace(ccButton);
+					if (!heldInputs.press(ccButton)) continue; // skip if already held
 					inputState = Press;
 				}
 				else {
-					if (!heldInputs.contains(ccButton)) continue; // skip if not held
-					heldInputs.erase(ccButton);
+					if (!heldInputs.release(ccButton)) continue; // skip if not held
 					inputState = Release;
 				}
 
 				LARGE_INTEGER time;
 				QueryPerformanceCounter(&time);
-				PlayerButton inputType;
-				bool player1 = true;
+				InputButton inputType;
+				bool player1;
 
-				{
-					std::lock_guard lock(keybindsLock);
-
-					if (inputBinds[p1Jump].contains(ccButton)) inputType = PlayerButton::Jump;
-					else if (inputBinds[p1Left].contains(ccButton)) inputType = PlayerButton::Left;
-					else if (inputBinds[p1Right].contains(ccButton)) inputType = PlayerButton::Right;
-					else {
-						player1 = false;
-						if (inputBinds[p2Jump].contains(ccButton)) inputType = PlayerButton::Jump;
-						else if (inputBinds[p2Left].contains(ccButton)) inputType = PlayerButton::Left;
-						else if (inputBinds[p2Right].contains(ccButton)) inputType = PlayerButton::Right;
-						else continue;
-					}
-				}
-				{
-					std::lock_guard lock(inputQueueLock);
-					inputQueue.emplace_back(InputEvent{ timestampFromLarge(time), inputType, inputState, player1 });
+				if (!keyBindings.lookup(ccButton, inputType, player1)) continue;
+				timeline.instant("xinput");
+				if (!inputLanes.push(XinputLane, InputEvent{ timestampFromLarge(time), inputType, inputState, player1 })) {
+					log::warn("Xinput lane full");
 				}
 			}
 		}
@@ -316,27 +312,15 @@ class $modify(CreatorLayer) {
 	bool init() {
 		if (!CreatorLayer::init()) return false;
 
-		if (linuxNative) {
-			DWORD waitResult = WaitForSingleObject(hMutex, 5);
-			if (waitResult == WAIT_OBJECT_0) {
-				if (static_cast<LinuxInputEvent*>(pBuf)[0].type == 3 && !softToggle.load()) {
-					log::error("Linux input failed");
-					FLAlertLayer* popup = FLAlertLayer::create(
-						"CBF Linux",
-						"Failed to read input devices.\nOn most distributions, this can be resolved with the following command: <cr>sudo usermod -aG input $USER</c> (reboot afterward; this will make your system slightly less secure).\nIf the issue persists, please contact the mod developer.",
-						"OK"
-					);
-					popup->m_scene = this;
-					popup->show();
-				}
-				ReleaseMutex(hMutex);
-			}
-			else if (waitResult == WAIT_TIMEOUT) {
-				log::error("Mutex stalling");
-			}
-			else {
-				// log::error("CreatorLayer WaitForSingleObject failed: {}", GetLastError());
-			}
+		if (linuxNative && linuxInputRing && linuxInputRing->status.load(std::memory_order_acquire) == LinuxHelperNoDevices && !softToggle.load()) {
+			log::error("Linux input failed");
+			FLAlertLayer* popup = FLAlertLayer::create(
+				"CBF Linux",
+				"Failed to read input devices.\nOn most distributions, this can be resolved with the following command: <cr>sudo usermod -aG input $USER</c> (reboot afterward; this will make your system slightly less secure).\nIf the issue persists, please contact the mod developer.",
+				"OK"
+			);
+			popup->m_scene = this;
+			popup->show();
 		}
 		return true;
 	}
@@ -354,237 +338,242 @@ void linuxCheckInputs() {
 		{ BTN_START, CONTROLLER_Start },
 	};
 
-	DWORD waitResult = WaitForSingleObject(hMutex, 1);
-	if (waitResult == WAIT_OBJECT_0) {
-		LinuxInputEvent* events = static_cast<LinuxInputEvent*>(pBuf);
-		for (int i = 0; i < BUFFER_SIZE; i++) {
-			if (events[i].type == 0) break; // if there are no more events
-
-			InputEvent input;
-			bool player1 = true;
-			USHORT scanCode = events[i].code;
-			int value = events[i].value;
-
-			switch (events[i].deviceType) {
-			case MOUSE:
-			case TOUCHPAD:
-				if (scanCode == BUTTON_LEFT) {
-					input.inputType = PlayerButton::Jump;
-				}
-				else if (scanCode == BUTTON_RIGHT) {
-					if (!enableRightClick.load()) continue;
-					input.inputType = PlayerButton::Jump;
-					player1 = false;
-				}
-				break;
-			case KEYBOARD: {
-				USHORT keyCode = MapVirtualKeyExA(scanCode, MAPVK_VSC_TO_VK, GetKeyboardLayout(0));
-				if (inputBinds[p1Jump].contains(keyCode)) input.inputType = PlayerButton::Jump;
-				else if (inputBinds[p1Left].contains(keyCode)) input.inputType = PlayerButton::Left;
-				else if (inputBinds[p1Right].contains(keyCode)) input.inputType = PlayerButton::Right;
-				else {
-					player1 = false;
-					if (inputBinds[p2Jump].contains(keyCode)) input.inputType = PlayerButton::Jump;
-					else if (inputBinds[p2Left].contains(keyCode)) input.inputType = PlayerButton::Left;
-					else if (inputBinds[p2Right].contains(keyCode)) input.inputType = PlayerButton::Right;
-					else continue;
-				}
-				break;
+	static uint32_t reportedOverflows = 0;
+
+	TimelineScope scope(timeline, "linuxCheckInputs");
+
+	LinuxInputRing* ring = linuxInputRing;
+	if (!ring) return; // setup failed
+
+	const uint32_t head = ring->head.load(std::memory_order_acquire);
+	uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+
+	for (; tail != head; tail++) {
+		const LinuxInputEvent& event = ring->events[tail & (LINUX_RING_CAPACITY - 1)];
+
+		InputEvent input;
+		bool player1 = true;
+		USHORT scanCode = event.code;
+		int value = event.value;
+
+		switch (event.deviceType) {
+		case MOUSE:
+		case TOUCHPAD:
+			if (scanCode == BUTTON_LEFT) {
+				input.inputType = InputButton::Jump;
 			}
-			case TOUCHSCREEN:
-				if (scanCode == BTN_TOUCH) { // touching screen
-					input.inputType = PlayerButton::Jump;
-				}
-				break;
-			case CONTROLLER: {
-				int keyCode = -1;
-				if (events[i].type == EV_KEY) {
-					keyCode = linuxToCCKey[scanCode];
-				}
-				else if (events[i].type == EV_ABS) {
-					bool continueLoop = false;
-					auto analyze4Directions = [&](int deadzone, enumKeyCodes negative, enumKeyCodes positive) {
-						if (events[i].value < -deadzone) {
-							keyCode = negative;
-							if (heldInputs.contains(negative)) {
-								continueLoop = true; // already held, ignore
-							}
-							value = Press;
-						}
-						else if (events[i].value > deadzone) {
-							keyCode = positive;
-							if (heldInputs.contains(positive)) {
-								continueLoop = true; // already held, ignore
-							}
-							value = Press;
-						}
-						else {
-							value = Release;
-							if (heldInputs.contains(negative)) {
-								keyCode = negative;
-							}
-							else if (heldInputs.contains(positive)) {
-								keyCode = positive;
-							}
-							else {
-								continueLoop = true; // continue cuz button was already released
-							}
+			else if (scanCode == BUTTON_RIGHT) {
+				if (!enableRightClick.load()) continue;
+				input.inputType = InputButton::Jump;
+				player1 = false;
+			}
+			break;
+		case KEYBOARD: {
+			USHORT keyCode = MapVirtualKeyExA(scanCode, MAPVK_VSC_TO_VK, GetKeyboardLayout(0));
+			if (!keyBindings.lookup(keyCode, input.inputType, player1)) continue;
+			break;
+		}
+		case TOUCHSCREEN:
+			if (scanCode == BTN_TOUCH) { // touching screen
+				input.inputType = InputButton::Jump;
+			}
+			break;
+		case CONTROLLER: {
+			int keyCode = -1;
+			if (event.type == EV_KEY) {
+				keyCode = linuxToCCKey[scanCode];
+			}
+			else if (event.type == EV_ABS) {
+				bool continueLoop = false;
+				auto analyze4Directions = [&](int deadzone, enumKeyCodes negative, enumKeyCodes positive) {
+					if (event.value < -deadzone) {
+						keyCode = negative;
+						if (heldInputs.contains(negative)) {
+							continueLoop = true; // already held, ignore
 						}
-						};
-
-					switch (events[i].code) {
-					case ABS_X: // left thumbstick x
-						analyze4Directions(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_LEFT, CONTROLLER_LTHUMBSTICK_RIGHT);
-						break;
-					case ABS_Y: // left thumbstick y
-						analyze4Directions(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_UP, CONTROLLER_LTHUMBSTICK_DOWN);
-						break;
-					case ABS_RX: // right thumbstick x
-						analyze4Directions(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_LEFT, CONTROLLER_RTHUMBSTICK_RIGHT);
-						break;
-					case ABS_RY: // right thumbstick y
-						analyze4Directions(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_UP, CONTROLLER_RTHUMBSTICK_DOWN);
-						break;
-					case ABS_HAT0X: // dpadx
-						analyze4Directions(10, CONTROLLER_Left, CONTROLLER_Right);
-						break;
-					case ABS_HAT0Y: // dpady
-						analyze4Directions(10, CONTROLLER_Up, CONTROLLER_Down);
-						break;
-					case ABS_Z:
-						keyCode = CONTROLLER_LT;
-						if (events[i].value > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) {
-							value = Press;
+						value = Press;
+					}
+					else if (event.value > deadzone) {
+						keyCode = positive;
+						if (heldInputs.contains(positive)) {
+							continueLoop = true; // already held, ignore
 						}
-						else {
-							value = Release;
+						value = Press;
+					}
+					else {
+						value = Release;
+						if (heldInputs.contains(negative)) {
+							keyCode = negative;
 						}
-						break;
-					case ABS_RZ:
-						keyCode = CONTROLLER_RT;
-						if (events[i].value > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) {
-							value = Press;
+						else if (heldInputs.contains(positive)) {
+							keyCode = positive;
 						}
 						else {
-							value = Release;
+							continueLoop = true; // continue cuz button was already released
 						}
-						break;
 					}
-					if (continueLoop) continue;
-				}
-				if (inputBinds[p1Jump].contains(keyCode)) input.inputType = PlayerButton::Jump;
-				else if (inputBinds[p1Left].contains(keyCode)) input.inputType = PlayerButton::Left;
-				else if (inputBinds[p1Right].contains(keyCode)) input.inputType = PlayerButton::Right;
-				else {
-					player1 = false;
-					if (inputBinds[p2Jump].contains(keyCode)) input.inputType = PlayerButton::Jump;
-					else if (inputBinds[p2Left].contains(keyCode)) input.inputType = PlayerButton::Left;
-					else if (inputBinds[p2Right].contains(keyCode)) input.inputType = PlayerButton::Right;
-					else continue;
-				}
-				if (value == Press) {
-					if (heldInputs.contains(keyCode)) {
-						continue; // already held, ignore
+					};
+
+				switch (event.code) {
+				case ABS_X: // left thumbstick x
+					analyze4Directions(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_LEFT, CONTROLLER_LTHUMBSTICK_RIGHT);
+					break;
+				case ABS_Y: // left thumbstick y
+					analyze4Directions(XINPUT_GAMEPAD_LEFT_THUMB_DEADZONE, CONTROLLER_LTHUMBSTICK_UP, CONTROLLER_LTHUMBSTICK_DOWN);
+					break;
+				case ABS_RX: // right thumbstick x
+					analyze4Directions(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_LEFT, CONTROLLER_RTHUMBSTICK_RIGHT);
+					break;
+				case ABS_RY: // right thumbstick y
+					analyze4Directions(XINPUT_GAMEPAD_RIGHT_THUMB_DEADZONE, CONTROLLER_RTHUMBSTICK_UP, CONTROLLER_RTHUMBSTICK_DOWN);
+					break;
+				case ABS_HAT0X: // dpadx
+					analyze4Directions(10, CONTROLLER_Left, CONTROLLER_Right);
+					break;
+				case ABS_HAT0Y: // dpady
+					analyze4Directions(10, CONTROLLER_Up, CONTROLLER_Down);
+					break;
+				case ABS_Z:
+					keyCode = CONTROLLER_LT;
+					if (event.value > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) {
+						value = Press;
 					}
 					else {
-						heldInputs.emplace(keyCode);
+						value = Release;
 					}
-				}
-				else {
-					if (!heldInputs.contains(keyCode)) {
-						continue; // already released, ignore
+					break;
+				case ABS_RZ:
+					keyCode = CONTROLLER_RT;
+					if (event.value > XINPUT_GAMEPAD_TRIGGER_THRESHOLD) {
+						value = Press;
 					}
 					else {
-						heldInputs.erase(keyCode);
+						value = Release;
 					}
+					break;
 				}
-				break;
+				if (continueLoop) continue;
 			}
-			default:
-				continue;
+			if (!keyBindings.lookup(keyCode, input.inputType, player1)) continue;
+			if (value == Press) {
+				if (!heldInputs.press(keyCode)) continue; // already held, ignore
 			}
+			else {
+				if (!heldInputs.release(keyCode)) continue; // already released, ignore
+			}
+			break;
+		}
+		default:
+			continue;
+		}
 
-			input.inputState = value;
-			input.time = timestampFromLarge(events[i].time);
-			input.isPlayer1 = player1;
+		input.inputState = value;
+		input.time = event.time;
+		input.isPlayer1 = player1;
 
-			inputQueue.emplace_back(input);
+		if (!inputLanes.push(LinuxLane, input)) {
+			log::warn("Linux input lane full");
 		}
-		ZeroMemory(events, sizeof(LinuxInputEvent[BUFFER_SIZE]));
-		ReleaseMutex(hMutex);
 	}
-	else if (waitResult != WAIT_TIMEOUT) {
-		log::error("WaitForSingleObject failed: {}", GetLastError());
+
+	ring->tail.store(tail, std::memory_order_release);
+
+	const uint32_t overflows = ring->overflows.load(std::memory_order_relaxed);
+	if (overflows != reportedOverflows) {
+		log::warn("Linux input helper dropped {} events", overflows - reportedOverflows);
+		reportedOverflows = overflows;
 	}
 }
 
-void windowsSetup() {
-	HANDLE gdMutex;
+bool isOwnWindow(HWND hwnd) {
+	DWORD pid = 0;
+	if (hwnd) GetWindowThreadProcessId(hwnd, &pid);
+	return pid == GetCurrentProcessId();
+}
 
+void CALLBACK foregroundChanged(HWINEVENTHOOK, DWORD, HWND hwnd, LONG, LONG, DWORD, DWORD) {
+	inputGate.set(GateUnfocused, !isOwnWindow(hwnd));
+}
+
+/*
+Wine on Linux with the workaround on takes its inputs from the Linux helper, and the game clock switches
+from QPC to FILETIME for it. Called before any setting is applied, since several of them convert to clock ticks.
+*/
+void detectLinuxNative() {
 	HMODULE ntdll = GetModuleHandle("ntdll.dll");
 	typedef void (*wine_get_host_version)(const char** sysname, const char** release);
 	wine_get_host_version wghv = (wine_get_host_version)GetProcAddress(ntdll, "wine_get_host_version");
-	if (wghv) { // if this function exists, the user is on Wine
-		const char* sysname;
-		const char* release;
-		wghv(&sysname, &release);
-
-		std::string sys = sysname;
-		log::info("Wine {}", sys);
-
-		if (sys == "Linux") Mod::get()->setSavedValue<bool>("you-must-be-on-linux-to-change-this", true);
-		if (sys == "Linux" && Mod::get()->getSettingValue<bool>("wine-workaround")) { // background raw keyboard input doesn't work in Wine
-			linuxNative = true;
-			log::info("Linux native");
-
-			hSharedMem = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LinuxInputEvent[BUFFER_SIZE]), "LinuxSharedMemory");
-			if (hSharedMem == NULL) {
-				log::error("Failed to create file mapping: {}", GetLastError());
-				return;
-			}
+	if (!wghv) return; // only Wine has this function
 
-			pBuf = MapViewOfFile(hSharedMem, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LinuxInputEvent[BUFFER_SIZE]));
-			if (pBuf == NULL) {
-				log::error("Failed to map view of file: {}", GetLastError());
-				CloseHandle(hSharedMem);
-				return;
-			}
+	const char* sysname;
+	const char* release;
+	wghv(&sysname, &release);
 
-			hMutex = CreateMutex(NULL, FALSE, "CBFLinuxMutex"); // used to gate access to the shared memory buffer for inputs
-			if (hMutex == NULL) {
-				log::error("Failed to create shared memory mutex: {}", GetLastError());
-				CloseHandle(hSharedMem);
-				return;
-			}
+	std::string sys = sysname;
+	log::info("Wine {}", sys);
 
-			gdMutex = CreateMutex(NULL, TRUE, "CBFWatchdogMutex"); // will be released when gd closes
-			if (gdMutex == NULL) {
-				log::error("Failed to create watchdog mutex: {}", GetLastError());
-				CloseHandle(hMutex);
-				CloseHandle(hSharedMem);
-				return;
-			}
+	if (sys == "Linux") Mod::get()->setSavedValue<bool>("you-must-be-on-linux-to-change-this", true);
+	if (sys == "Linux" && Mod::get()->getSettingValue<bool>("wine-workaround")) { // background raw keyboard input doesn't work in Wine
+		linuxNative = true;
+		log::info("Linux native");
+	}
+}
 
-			SECURITY_ATTRIBUTES sa;
-			sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-			sa.bInheritHandle = TRUE;
-			sa.lpSecurityDescriptor = NULL;
-
-			STARTUPINFO si;
-			PROCESS_INFORMATION pi;
-			ZeroMemory(&si, sizeof(si));
-			si.cb = sizeof(si);
-			ZeroMemory(&pi, sizeof(pi));
-
-			std::string path = CCFileUtils::get()->fullPathForFilename("linux-input.so"_spr, true);
-
-			if (!CreateProcess(path.c_str(), NULL, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
-				log::error("Failed to launch Linux input program: {}", GetLastError());
-				CloseHandle(hMutex);
-				CloseHandle(gdMutex);
-				CloseHandle(hSharedMem);
-				return;
-			}
+void windowsSetup() {
+	HANDLE gdMutex;
+
+	// follow foreground changes instead of calling GetFocus() every frame, the events arrive through the main thread's message loop
+	inputGate.set(GateUnfocused, !isOwnWindow(GetForegroundWindow()));
+	if (!SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL, foregroundChanged, 0, 0, WINEVENT_OUTOFCONTEXT)) {
+		log::error("Failed to hook foreground changes: {}", GetLastError());
+		inputGate.set(GateUnfocused, false);
+	}
+
+	if (linuxNative) {
+		hSharedMem = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(LinuxInputRing), "LinuxSharedMemory");
+		if (hSharedMem == NULL) {
+			log::error("Failed to create file mapping: {}", GetLastError());
+			return;
+		}
+
+		LPVOID pBuf = MapViewOfFile(hSharedMem, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(LinuxInputRing));
+		if (pBuf == NULL) {
+			log::error("Failed to map view of file: {}", GetLastError());
+			CloseHandle(hSharedMem);
+			return;
+		}
+
+		// the mapping starts out zeroed, so head, tail and status are already valid
+		linuxInputRing = static_cast<LinuxInputRing*>(pBuf);
+		linuxInputRing->magic = LINUX_RING_MAGIC;
+		linuxInputRing->version = LINUX_RING_VERSION;
+		linuxInputRing->capacity = LINUX_RING_CAPACITY;
+
+		gdMutex = CreateMutex(NULL, TRUE, "CBFWatchdogMutex"); // will be released when gd closes
+		if (gdMutex == NULL) {
+			log::error("Failed to create watchdog mutex: {}", GetLastError());
+			CloseHandle(hSharedMem);
+			return;
+		}
+
+		SECURITY_ATTRIBUTES sa;
+		sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+		sa.bInheritHandle = TRUE;
+		sa.lpSecurityDescriptor = NULL;
+
+		STARTUPINFO si;
+		PROCESS_INFORMATION pi;
+		ZeroMemory(&si, sizeof(si));
+		si.cb = sizeof(si);
+		ZeroMemory(&pi, sizeof(pi));
+
+		std::string path = CCFileUtils::get()->fullPathForFilename("linux-input.so"_spr, true);
+
+		if (!CreateProcess(path.c_str(), NULL, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
+			log::error("Failed to launch Linux input program: {}", GetLastError());
+			CloseHandle(gdMutex);
+			CloseHandle(hSharedMem);
+			return;
 		}
 	}
 
@@ -2,30 +2,10 @@
 
 #include <Geode/Geode.hpp>
 #include "linuxeventcodes.hpp"
-
-enum DeviceType : int8_t {
-    MOUSE,
-    TOUCHPAD,
-    KEYBOARD,
-    TOUCHSCREEN,
-    CONTROLLER,
-    UNKNOWN
-};
-
-// MSVC compatibility fix: Use #pragma pack instead of __attribute__
-#pragma pack(push, 1)
-struct LinuxInputEvent {
-    LARGE_INTEGER time;
-    USHORT type;
-    USHORT code;
-    int value;
-    DeviceType deviceType;
-};
-#pragma pack(pop)
+#include "linuxshared.hpp"
 
 extern HANDLE hSharedMem;
-extern HANDLE hMutex;
-extern LPVOID pBuf;
+extern LinuxInputRing* linuxInputRing;
 
 extern bool linuxNative;
 
@@ -39,8 +19,7 @@ inline TimestampType timestampFromLarge(LARGE_INTEGER l) {
     return l.QuadPart;
 }
 
-constexpr size_t BUFFER_SIZE = 20;
-
+void detectLinuxNative();
 void windowsSetup();
 void linuxCheckInputs();
 void rawInputThread();
\ No newline at end of file
@@ -0,0 +1,153 @@
+// replays the frame starts, build times and inputs of a trace under early, late and adaptive cutoff and compares latency and placement
+
+#include "tracefile.hpp"
+
+#include "core/cutoff.hpp"
+#include "core/histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Frame {
+	TimestampType frameStart;
+	TimestampType build;
+	bool firstFrame;
+};
+
+enum class Cutoff {
+	Early,
+	Late,
+	Adaptive
+};
+
+struct Report {
+	Histogram latencyNs; // input to the buildStepQueue that planned it
+	Histogram errorNs;   // how far the plan put the input from where the frame starts say it happened
+	uint64_t overBound = 0;
+	double meanOffsetMs = 0.0;
+};
+
+static std::vector<TimestampType> cutoffs(const std::vector<Frame>& frames, Cutoff mode, TimestampType bound) {
+	AdaptiveCutoff adaptive;
+	adaptive.setErrorBound(bound);
+
+	std::vector<TimestampType> cuts;
+	cuts.reserve(frames.size());
+	for (const Frame& frame : frames) {
+		switch (mode) {
+		case Cutoff::Early: cuts.push_back(frame.frameStart); break;
+		case Cutoff::Late: cuts.push_back(frame.build); break;
+		case Cutoff::Adaptive: cuts.push_back(frame.frameStart + adaptive.offset(frame.build - frame.frameStart)); break;
+		}
+	}
+	return cuts;
+}
+
+/*
+The game simulates the time between frame starts, so an input at t belongs at t - offset in game time,
+where offset is how far past the frame start the mode cuts on average (a constant delay is latency, not imprecision).
+The plan instead spreads the inputs between two cutoffs evenly over the frame, which is where they end up.
+*/
+static void evaluate(const std::vector<Frame>& frames, const std::vector<TimestampType>& inputs, Cutoff mode, TimestampType bound, double nsPerTick, Report& report) {
+	const std::vector<TimestampType> cuts = cutoffs(frames, mode, bound);
+
+	double offsetSum = 0.0;
+	for (size_t k = 0; k < frames.size(); k++) offsetSum += static_cast<double>(cuts[k] - frames[k].frameStart);
+	const double offset = frames.empty() ? 0.0 : offsetSum / frames.size();
+	report.meanOffsetMs = offset * nsPerTick / 1e6;
+
+	size_t next = 0;
+	for (size_t k = 0; k < frames.size(); k++) {
+		// inputs before a reset, or before the first cutoff, are dropped by the scheduler too
+		if (k == 0 || frames[k].firstFrame || cuts[k] <= cuts[k - 1]) {
+			while (next < inputs.size() && inputs[next] <= cuts[k]) next++;
+			continue;
+		}
+
+		const double span = static_cast<double>(cuts[k] - cuts[k - 1]);
+		const double frameLength = static_cast<double>(frames[k].frameStart - frames[k - 1].frameStart);
+
+		for (; next < inputs.size() && inputs[next] <= cuts[k]; next++) {
+			const TimestampType t = inputs[next];
+			const double placed = frames[k - 1].frameStart + (t - cuts[k - 1]) / span * frameLength;
+			const double error = std::abs(placed - (t - offset)) * nsPerTick;
+
+			report.latencyNs.record(static_cast<uint64_t>(std::max<TimestampType>(frames[k].build - t, 0) * nsPerTick));
+			report.errorNs.record(static_cast<uint64_t>(error));
+			if (error > bound * nsPerTick) report.overBound++;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* path = nullptr;
+	double boundUs = static_cast<double>(ADAPTIVE_CUTOFF_DEFAULT_BOUND_US);
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--bound-us") == 0 && i + 1 < argc) boundUs = std::atof(argv[++i]);
+		else path = argv[i];
+	}
+
+	if (!path || boundUs < 0.0) {
+		std::fprintf(stderr, "usage: %s [--bound-us <adaptive placement error bound>] <trace.cbftrace>\n", argv[0]);
+		return 2;
+	}
+
+	TraceFile trace;
+	if (std::string error = trace.open(path); !error.empty()) {
+		std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+		return 1;
+	}
+
+	std::vector<Frame> frames;
+	std::vector<TimestampType> inputs;
+	for (const TraceRecord& record : trace) {
+		if (record.kind == TraceInput) inputs.push_back(record.input.time);
+		else if (record.kind == TraceFrame) {
+			frames.push_back(Frame{ record.frame.frameStartTime, record.frame.buildTime, (record.frame.flags & TraceFirstFrame) != 0 });
+		}
+	}
+	std::sort(inputs.begin(), inputs.end());
+
+	if (frames.empty() || std::all_of(frames.begin(), frames.end(), [](const Frame& f) { return f.build == 0; })) {
+		std::fprintf(stderr, "%s: no frame start and build times, record the trace with version 2 or later\n", path);
+		return 1;
+	}
+
+	const double nsPerTick = 1e9 / static_cast<double>(trace.header().ticksPerSecond);
+	const TimestampType bound = static_cast<TimestampType>(boundUs * trace.header().ticksPerSecond / 1e6);
+
+	Histogram gapNs;
+	for (const Frame& frame : frames) gapNs.record(static_cast<uint64_t>(std::max<TimestampType>(frame.build - frame.frameStart, 0) * nsPerTick));
+
+	std::printf("%s: %zu frames, %zu inputs\n", path, frames.size(), inputs.size());
+	std::printf("frame start to build: p2 %.3fms, p50 %.3fms, p99 %.3fms\n\n",
+		gapNs.percentile(ADAPTIVE_CUTOFF_FRACTION) / 1e6, gapNs.percentile(0.5) / 1e6, gapNs.percentile(0.99) / 1e6);
+
+	std::printf("%-10s %10s %10s %10s %10s %10s %10s %10s %12s\n", "cutoff", "offset ms", "lat mean", "lat p50", "lat p99", "err p50us", "err p99us", "err max", "over bound");
+
+	const std::pair<const char*, Cutoff> modes[] = {
+		{ "early", Cutoff::Early },
+		{ "late", Cutoff::Late },
+		{ "adaptive", Cutoff::Adaptive },
+	};
+	for (const auto& [name, mode] : modes) {
+		auto report = std::make_unique<Report>();
+		evaluate(frames, inputs, mode, bound, nsPerTick, *report);
+		const Report& r = *report;
+		const uint64_t count = r.errorNs.count();
+		std::printf("%-10s %10.3f %10.3f %10.3f %10.3f %10.1f %10.1f %10.1f %11.2f%%\n", name, r.meanOffsetMs,
+			r.latencyNs.mean() / 1e6, r.latencyNs.percentile(0.5) / 1e6, r.latencyNs.percentile(0.99) / 1e6,
+			r.errorNs.percentile(0.5) / 1e3, r.errorNs.percentile(0.99) / 1e3, r.errorNs.max() / 1e3,
+			count ? 100.0 * r.overBound / count : 0.0);
+	}
+
+	std::printf("\nlatency in ms from the input to the frame that plans it, errors against a %.0fus bound\n", boundUs);
+	return 0;
+}
@@ -0,0 +1,188 @@
+// runs a frame time series through every physics bypass mode and 2.2 predictor and compares how the step counts behave
+
+#include "tracefile.hpp"
+
+#include "core/scheduler.hpp"
+#include "core/predictor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Frame {
+	float delta;
+	float timewarp;
+	double animationInterval;
+};
+
+struct Report {
+	double meanSteps = 0.0;
+	double stepVariance = 0.0;
+	uint64_t stepChanges = 0;    // frames whose step count differs from the previous one
+	uint64_t catchUpFrames = 0;  // frames with more steps than a smooth frame at the target refresh rate gets
+	double finalDriftMs = 0.0;   // time the steps would cover at the steady step size, minus real time
+	double maxDriftMs = 0.0;
+	double stepJitterUs = 0.0;   // standard deviation of the physics step length (frame time / steps)
+	double tickRate = 0.0;       // steps per second of real time
+	std::vector<int> steps;
+};
+
+// either a recorded .cbftrace, or a text file with one frame time in milliseconds per line
+static std::string loadFrames(const char* path, double fps, std::vector<Frame>& frames) {
+	if (std::strstr(path, ".cbftrace")) {
+		TraceFile trace;
+		if (std::string error = trace.open(path); !error.empty()) return error;
+
+		for (const TraceRecord& record : trace) {
+			if (record.kind != TraceFrame || (record.frame.flags & TraceFirstFrame)) continue;
+			frames.push_back(Frame{ record.frame.modifiedDelta, record.frame.timewarp, record.frame.animationInterval });
+		}
+		return {};
+	}
+
+	std::ifstream file(path);
+	if (!file) return "can't open file";
+
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		double ms;
+		if (!(fields >> ms) || ms <= 0.0) continue;
+		frames.push_back(Frame{ static_cast<float>(ms / 1000.0), 1.0f, 1.0 / fps });
+	}
+	return {};
+}
+
+// one row of the report: a step count strategy and what it needs in StepCountState
+struct Mode {
+	std::string name;
+	StepCountMode stepCountMode;
+	FramePredictor* predictor = nullptr;
+	bool legacyBypass = false;
+	int fixedTps = 0; // 0 outside fixed mode
+};
+
+static Report evaluate(const std::vector<Frame>& frames, const Mode& mode) {
+	StepCountState state;
+	state.physicsBypass = true;
+	state.legacyBypass = mode.legacyBypass;
+	state.fixedBypass = mode.fixedTps > 0;
+	if (mode.fixedTps > 0) state.fixedTps = mode.fixedTps;
+	state.predictor = mode.predictor;
+	if (mode.predictor) mode.predictor->reset();
+
+	Report report;
+	report.steps.reserve(frames.size());
+
+	double sum = 0.0;
+	double sumSquares = 0.0;
+	double drift = 0.0;
+	double stepLengthSum = 0.0;
+	double stepLengthSquares = 0.0;
+	double time = 0.0;
+
+	for (const Frame& frame : frames) {
+		state.animationInterval = frame.animationInterval;
+		const int steps = calculateStepCount(mode.stepCountMode, state, frame.delta, frame.timewarp);
+
+		// at the target refresh rate every step covers animationInterval / smoothSteps, or one tick in fixed mode
+		const double slowdown = std::min(1.0f, frame.timewarp);
+		const double stepsPerSecond = mode.fixedTps > 0 ? mode.fixedTps : 240.0;
+		const int smoothSteps = static_cast<int>(std::round(std::ceil((frame.animationInterval * stepsPerSecond) - STEP_EPSILON) / slowdown));
+		const double steadyStep = mode.fixedTps > 0 ? 1.0 / mode.fixedTps : frame.animationInterval / smoothSteps;
+
+		if (!report.steps.empty() && steps != report.steps.back()) report.stepChanges++;
+		if (steps > smoothSteps) report.catchUpFrames++;
+
+		drift += steps * steadyStep * slowdown - frame.delta;
+		report.maxDriftMs = std::max(report.maxDriftMs, std::abs(drift) * 1000.0);
+
+		const double stepLength = frame.delta / steps;
+		stepLengthSum += stepLength;
+		stepLengthSquares += stepLength * stepLength;
+
+		sum += steps;
+		sumSquares += static_cast<double>(steps) * steps;
+		time += frame.delta;
+		report.steps.push_back(steps);
+	}
+
+	if (!frames.empty()) {
+		report.meanSteps = sum / frames.size();
+		report.stepVariance = sumSquares / frames.size() - report.meanSteps * report.meanSteps;
+
+		const double meanLength = stepLengthSum / frames.size();
+		report.stepJitterUs = std::sqrt(std::max(0.0, stepLengthSquares / frames.size() - meanLength * meanLength)) * 1e6;
+	}
+	if (time > 0.0) report.tickRate = sum / time;
+	report.finalDriftMs = drift * 1000.0;
+	return report;
+}
+
+int main(int argc, char** argv) {
+	const char* path = nullptr;
+	double fps = 60.0;
+	std::vector<int> fixedRates;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) fps = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--fixed-tps") == 0 && i + 1 < argc) fixedRates.push_back(std::atoi(argv[++i]));
+		else path = argv[i];
+	}
+
+	if (!path || fps <= 0.0 || std::find_if(fixedRates.begin(), fixedRates.end(), [](int tps) { return tps <= 0; }) != fixedRates.end()) {
+		std::fprintf(stderr, "usage: %s [--fps <target fps for text files>] [--fixed-tps <rate>]... <trace.cbftrace | frametimes.txt>\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<Frame> frames;
+	if (std::string error = loadFrames(path, fps, frames); !error.empty()) {
+		std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+		return 1;
+	}
+	if (frames.empty()) {
+		std::fprintf(stderr, "%s: no frames\n", path);
+		return 1;
+	}
+
+	if (fixedRates.empty()) fixedRates = { 480, 720, 1000 };
+
+	EmaPredictor ema;
+	MedianPredictor median;
+	PercentilePredictor percentile;
+
+	const StepCountMode modern = StepCountMode::Modern;
+	std::vector<Mode> modes = {
+		{ "2.2", modern },
+		{ "2.2 ema", modern, &ema },
+		{ "2.2 median", modern, &median },
+		{ "2.2 pctile", modern, &percentile },
+		{ "2.1", StepCountMode::Legacy, nullptr, true },
+	};
+	for (int tps : fixedRates) modes.push_back({ "fixed " + std::to_string(tps), StepCountMode::Fixed, nullptr, false, tps });
+
+	std::printf("%s: %zu frames\n\n", path, frames.size());
+	std::printf("%-12s %10s %10s %10s %10s %12s %12s %12s %10s\n", "mode", "mean", "variance", "changes", "catch-up", "drift ms", "max drift", "jitter us", "tps");
+
+	std::vector<int> builtInSteps;
+	for (const Mode& mode : modes) {
+		const Report r = evaluate(frames, mode);
+		std::printf("%-12s %10.3f %10.3f %10llu %10llu %12.3f %12.3f %12.2f %10.1f\n", mode.name.c_str(), r.meanSteps, r.stepVariance,
+			static_cast<unsigned long long>(r.stepChanges), static_cast<unsigned long long>(r.catchUpFrames), r.finalDriftMs, r.maxDriftMs, r.stepJitterUs, r.tickRate);
+
+		if (mode.predictor == nullptr && mode.stepCountMode == modern) builtInSteps = r.steps;
+		if (mode.predictor == &ema && r.steps != builtInSteps) {
+			std::fprintf(stderr, "ema predictor doesn't match the built-in average\n");
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,187 @@
+// feeds a recorded trace through calculateStepCount and buildStepQueue (buildTickBuckets for Click on Steps frames), printing the step plans, timing and metrics
+
+#include "tracefile.hpp"
+
+#include "core/scheduler.hpp"
+#include "core/metrics.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+static const char* buttonName(InputButton button) {
+	switch (button) {
+	case InputButton::Jump: return "jump";
+	case InputButton::Left: return "left";
+	case InputButton::Right: return "right";
+	}
+	return "?";
+}
+
+static int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char** argv) {
+	const char* path = nullptr;
+	bool printPlans = false;
+	bool printMetrics = false;
+	double coalesceUs = 0.0;
+	int fixedTps = FIXED_TPS_DEFAULT;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--plans") == 0) printPlans = true;
+		else if (std::strcmp(argv[i], "--metrics") == 0) printMetrics = true;
+		else if (std::strcmp(argv[i], "--coalesce-us") == 0 && i + 1 < argc) coalesceUs = std::atof(argv[++i]);
+		else if (std::strcmp(argv[i], "--fixed-tps") == 0 && i + 1 < argc) fixedTps = std::atoi(argv[++i]);
+		else path = argv[i];
+	}
+
+	if (!path || fixedTps <= 0) {
+		std::fprintf(stderr, "usage: %s [--plans] [--metrics] [--coalesce-us <epsilon>] [--fixed-tps <tick rate of fixed bypass frames>] <trace.cbftrace>\n", argv[0]);
+		return 2;
+	}
+
+	TraceFile trace;
+	if (std::string error = trace.open(path); !error.empty()) {
+		std::fprintf(stderr, "%s: %s\n", path, error.c_str());
+		return 1;
+	}
+
+	std::printf("%s: version %u, %zu records, %lld ticks/s\n", path, trace.header().version, trace.size(), static_cast<long long>(trace.header().ticksPerSecond));
+
+	auto s = std::make_unique<StepScheduler>();
+
+	// frames happen exactly when the trace says they did
+	VirtualClock clock(trace.header().ticksPerSecond);
+	s->clock = &clock;
+	StepCountState state;
+	state.fixedTps = fixedTps;
+
+	auto metrics = std::make_unique<StepMetrics>();
+	metrics->nsPerTick = 1e9 / static_cast<double>(clock.frequency());
+	if (printMetrics) s->metrics = metrics.get();
+
+	s->coalesceTicks = static_cast<TimestampType>(coalesceUs * trace.header().ticksPerSecond / 1e6);
+
+	std::vector<InputEvent> pending;
+	uint64_t frames = 0;
+	uint64_t inputs = 0;
+	uint64_t steps = 0;
+	uint64_t substeps = 0;
+	uint64_t placedInputs = 0;
+	uint64_t stepCountMismatches = 0;
+	int64_t totalNs = 0;
+	int64_t maxNs = 0;
+
+	for (const TraceRecord& record : trace) {
+		if (record.kind == TraceInput) {
+			pending.push_back(record.input);
+			continue;
+		}
+		if (record.kind != TraceFrame) continue;
+
+		const TraceFrameRecord& frame = record.frame;
+
+
+		state.physicsBypass = frame.flags & TracePhysicsBypass;
+		state.legacyBypass = frame.flags & TraceLegacyBypass;
+		state.fixedBypass = frame.flags & TraceFixedBypass;
+		state.animationInterval = frame.animationInterval;
+
+		const int64_t start = nowNs();
+
+		const int stepCount = calculateStepCount(state, frame.modifiedDelta, frame.timewarp, false);
+
+		clock.set(frame.currentFrameTime);
+		markFrameTime(*s);
+		if (frame.flags & TraceFirstFrame) s->firstFrame = true;
+
+		// build with the recorded step count so the plan matches what the game ran
+		// straight from the recording in the order the game drained it, the lanes would cap a big frame at their capacity
+		const size_t drained = drainInputs(*s, pending.data(), pending.size(), frame.flags & TraceLateCutoff, frameInputLimit(*s));
+		const bool clickOnSteps = frame.flags & TraceClickOnSteps;
+		if (clickOnSteps) buildTickBuckets(*s, frame.stepCount);
+		else buildStepQueue(*s, frame.stepCount);
+
+		const int64_t elapsed = nowNs() - start;
+		totalNs += elapsed;
+		maxNs = std::max(maxNs, elapsed);
+
+		pending.erase(pending.begin(), pending.begin() + drained);
+		inputs += drained;
+
+		if (stepCount != frame.stepCount) stepCountMismatches++;
+
+		if (printPlans) {
+			std::printf("frame %llu: delta %.3fms, %d steps (recomputed %d), %.0fns\n",
+				static_cast<unsigned long long>(frames), trace.toMs(frame.currentFrameTime - frame.lastFrameTime),
+				frame.stepCount, stepCount, static_cast<double>(elapsed));
+		}
+
+		// Click on Steps frames are ticks with their inputs, there are no substeps to print
+		int tick = 0;
+		auto dispatch = [&](const InputEvent* tickInputs, size_t count) {
+			placedInputs += count;
+			if (!printPlans) return;
+			for (size_t i = 0; i < count; i++) {
+				const InputEvent& input = tickInputs[i];
+				std::printf("  %-8s tick %d  p%d %s %s at +%.3fms\n", i == 0 ? "input" : "+", tick, input.isPlayer1 ? 1 : 2,
+					buttonName(input.inputType), input.inputState ? "press" : "release", trace.toMs(input.time - frame.lastFrameTime));
+			}
+		};
+		while (clickOnSteps && dispatchTick(*s, dispatch)) {
+			steps++;
+			tick++;
+		}
+
+		while (!clickOnSteps && hasNextStep(*s)) {
+			const Step step = s->stepQueue.front();
+			s->stepQueue.pop_front();
+
+			if (step.endStep) steps++;
+			else substeps++;
+			placedInputs += step.inputCount;
+
+			if (!printPlans) continue;
+
+			if (step.endStep) {
+				std::printf("  end      factor %.6f\n", step.deltaFactor);
+			}
+			else {
+				for (uint16_t i = step.inputIndex; i < step.inputIndex + step.inputCount; i++) {
+					const InputEvent& input = s->inputs[i];
+					std::printf("  %-8s factor %.6f  p%d %s %s at +%.3fms\n", i == step.inputIndex ? "input" : "+", step.deltaFactor, input.isPlayer1 ? 1 : 2,
+						buttonName(input.inputType), input.inputState ? "press" : "release", trace.toMs(input.time - frame.lastFrameTime));
+				}
+			}
+		}
+
+		frames++;
+	}
+
+	std::printf("\n%llu frames, %llu inputs, %llu steps, %llu input substeps\n",
+		static_cast<unsigned long long>(frames), static_cast<unsigned long long>(inputs),
+		static_cast<unsigned long long>(steps), static_cast<unsigned long long>(substeps));
+	if (s->coalesceTicks > 0) {
+		// every coalesced input skips a PlayerObject::update split and a checkCollisions per split player
+		const uint64_t saved = placedInputs - substeps;
+		std::printf("coalescing within %.1fus: %llu substeps for %llu inputs, saved %llu substeps and %llu-%llu collision checks\n",
+			coalesceUs, static_cast<unsigned long long>(substeps), static_cast<unsigned long long>(placedInputs),
+			static_cast<unsigned long long>(saved), static_cast<unsigned long long>(saved), static_cast<unsigned long long>(saved * 2));
+	}
+	std::printf("step count differs from the recording on %llu frames\n", static_cast<unsigned long long>(stepCountMismatches));
+	if (!pending.empty()) std::printf("%zu recorded inputs were never drained\n", pending.size());
+	if (frames) std::printf("scheduler time: %.1fns/frame average, %lldns worst\n", static_cast<double>(totalNs) / frames, static_cast<long long>(maxNs));
+
+	if (printMetrics) {
+		std::printf("\n");
+		writeMetricsSummary(stdout, "trace", *metrics);
+	}
+
+	// the replay didn't get every input the game did, so its plans can't be trusted to match
+	return pending.empty() ? 0 : 1;
+}
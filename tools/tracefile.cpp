@@ -0,0 +1,50 @@
+#include "tracefile.hpp"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TraceFile::~TraceFile() {
+	if (m_data) munmap(m_data, m_length);
+}
+
+std::string TraceFile::open(const char* path) {
+	int fd = ::open(path, O_RDONLY);
+	if (fd == -1) return std::string("failed to open: ") + strerror(errno);
+
+	struct stat st;
+	if (fstat(fd, &st) == -1) {
+		close(fd);
+		return std::string("failed to stat: ") + strerror(errno);
+	}
+	if (static_cast<size_t>(st.st_size) < sizeof(TraceHeader)) {
+		close(fd);
+		return "file is too small to be a trace";
+	}
+
+	m_length = st.st_size;
+	m_data = mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m_data == MAP_FAILED) {
+		m_data = nullptr;
+		return std::string("failed to map: ") + strerror(errno);
+	}
+
+	const TraceHeader& h = header();
+	if (std::memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0) return "not a CBF trace";
+	if (h.version != TRACE_VERSION) return "trace version " + std::to_string(h.version) + ", this tool reads version " + std::to_string(TRACE_VERSION);
+	if (h.recordSize != sizeof(TraceRecord)) return "unexpected record size " + std::to_string(h.recordSize);
+	if (h.ticksPerSecond <= 0) return "invalid timestamp resolution";
+
+	const char* records = static_cast<const char*>(m_data) + sizeof(TraceHeader);
+
+	// a recording that didn't stop cleanly has no record count, use whatever made it to disk
+	const size_t available = (m_length - sizeof(TraceHeader)) / h.recordSize;
+	m_count = h.recordCount && h.recordCount <= available ? h.recordCount : available;
+	m_records = reinterpret_cast<const TraceRecord*>(records);
+
+	return {};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// read-only view of a recorded trace, mapped straight from disk
+
+#include "core/trace.hpp"
+
+#include <cstddef>
+#include <string>
+
+class TraceFile {
+public:
+	TraceFile() = default;
+	TraceFile(const TraceFile&) = delete;
+	TraceFile& operator=(const TraceFile&) = delete;
+	~TraceFile();
+
+	// returns an error message, or an empty string on success
+	std::string open(const char* path);
+
+	const TraceHeader& header() const {
+		return *static_cast<const TraceHeader*>(m_data);
+	}
+
+	const TraceRecord* begin() const {
+		return m_records;
+	}
+
+	const TraceRecord* end() const {
+		return m_records + m_count;
+	}
+
+	size_t size() const {
+		return m_count;
+	}
+
+	// converts timestamp ticks from this trace to milliseconds
+	double toMs(TimestampType ticks) const {
+		return static_cast<double>(ticks) * 1000.0 / header().ticksPerSecond;
+	}
+
+private:
+	void* m_data = nullptr;
+	size_t m_length = 0;
+	const TraceRecord* m_records = nullptr;
+	size_t m_count = 0;
+};